@@ -0,0 +1,407 @@
+// Offline opening-book builder.
+// Expands an opening tree from the start position with parallel fixed-depth
+// MultiPV NegaMax searches, keeps the moves within a score margin of the best,
+// scores the tree's leaves with quick self-play games and writes a sorted
+// binary book (see chess-bot/book.h) that the engine maps and binary-searches.
+//
+// chessbook --out book.bin --plies 12 --depth 9 --multipv 4 --margin 30
+//           --threads 12 --playout-depth 3 --min-score 0.35
+//
+// Every finished search and playout is appended to <out>.journal, so an
+// interrupted build picks up where it stopped when run again.
+
+#include "book.h"
+#include "chess.hpp"
+#include "hash-scheme.h"
+#include "memory-budget.h"
+#include "negamax.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct BookConfig {
+  std::string out;
+  int plies = 12;         // depth of the opening tree
+  int depth = 9;          // search depth per book position
+  int multiPV = 4;        // candidate moves searched per position
+  int margin = 30;        // keep moves within this many cp of the best
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  int playoutDepth = 3;   // search depth of the self-play games
+  double minScore = 0.35; // drop moves scoring worse in self-play
+};
+
+struct Edge {
+  std::string uci;
+  uint16_t move = 0;
+  int score = 0;       // search score for the side to move
+  uint64_t child = 0;  // hash of the resulting position
+  double selfPlay = 0; // mean self-play result for the side to move
+  uint32_t games = 0;  // self-play games below this move
+};
+
+struct Node {
+  std::string fen;
+  int ply = 0;
+  std::vector<Edge> edges;
+};
+
+// ---------------------------------------- journal ---------------------------------------- //
+
+// E <ply> <fen> <uci>:<score> ...   one searched position
+// P <fen> <white score>             one self-play game from a leaf
+class Journal {
+public:
+  explicit Journal(const std::string &path) : path(path) {}
+
+  void Load(std::map<uint64_t, Node> &nodes,
+            std::map<uint64_t, double> &playouts) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+      std::vector<std::string> fields;
+      std::stringstream ss(line);
+      for (std::string field; std::getline(ss, field, '\t');)
+        fields.push_back(field);
+
+      if (fields.size() == 4 && fields[0] == "E") {
+        Node node;
+        node.ply = std::stoi(fields[1]);
+        node.fen = fields[2];
+        chess::Board board(node.fen);
+        std::stringstream moves(fields[3]);
+        for (std::string item; moves >> item;) {
+          auto colon = item.find(':');
+          if (colon == std::string::npos)
+            continue;
+          node.edges.push_back(
+              MakeEdge(board, item.substr(0, colon),
+                       std::stoi(item.substr(colon + 1))));
+        }
+        nodes[board.hash()] = node;
+      } else if (fields.size() == 3 && fields[0] == "P") {
+        playouts[chess::Board(fields[1]).hash()] = std::stod(fields[2]);
+      }
+      // a torn last line (killed mid-write) matches neither and is redone
+    }
+  }
+
+  void Expanded(const Node &node) {
+    std::string line = "E\t" + std::to_string(node.ply) + "\t" + node.fen + "\t";
+    for (const Edge &edge : node.edges)
+      line += edge.uci + ":" + std::to_string(edge.score) + " ";
+    Append(line);
+  }
+
+  void PlayedOut(const std::string &fen, double whiteScore) {
+    Append("P\t" + fen + "\t" + std::to_string(whiteScore));
+  }
+
+  static Edge MakeEdge(chess::Board &board, const std::string &uci,
+                       int score) {
+    Edge edge;
+    chess::Move move = chess::uci::uciToMove(board, uci);
+    edge.uci = uci;
+    edge.move = move.move();
+    edge.score = score;
+    board.makeMove(move);
+    edge.child = board.hash();
+    board.unmakeMove(move);
+    return edge;
+  }
+
+private:
+  std::string path;
+  std::mutex mutex;
+
+  void Append(const std::string &line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream file(path, std::ios::app);
+    file << line << "\n";
+  }
+};
+
+// ---------------------------------------- building ---------------------------------------- //
+
+// Runs job(i, engine) for i in [0, count) on `threads` threads, one engine each
+template <typename Job>
+void Parallel(size_t count, int threads, Job job) {
+  std::atomic<size_t> next = 0;
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; t++)
+    pool.emplace_back([&]() {
+      NegaMax engine;
+      for (size_t i = next++; i < count; i = next++)
+        job(i, engine);
+    });
+  for (auto &thread : pool)
+    thread.join();
+}
+
+// Search a position and keep the candidate moves within the margin of the best
+Node Expand(const std::string &fen, int ply, NegaMax &engine,
+            const BookConfig &config) {
+  SearchLimits limits;
+  limits.depth = config.depth;
+  limits.multiPV = config.multiPV;
+  engine.Move(fen, limits);
+
+  Node node;
+  node.fen = fen;
+  node.ply = ply;
+  chess::Board board(fen);
+  const std::vector<SearchLine> &lines = engine.Lines();
+  for (const SearchLine &line : lines)
+    if (line.score >= lines.front().score - config.margin)
+      node.edges.push_back(Journal::MakeEdge(board, line.move, line.score));
+  return node;
+}
+
+// Quick self-play game from a leaf; white's score (1, 0.5 or 0)
+double PlayOut(const std::string &fen, NegaMax &engine,
+               const BookConfig &config) {
+  const int MAX_PLIES = 300; // adjudicate as a draw
+  SearchLimits limits;
+  limits.depth = config.playoutDepth;
+
+  chess::Board board(fen);
+  for (int ply = 0; ply < MAX_PLIES; ply++) {
+    auto [reason, result] = board.isGameOver();
+    if (result != chess::GameResult::NONE) {
+      if (result == chess::GameResult::DRAW)
+        return 0.5;
+      // the side to move lost
+      return board.sideToMove() == chess::Color::WHITE ? 0.0 : 1.0;
+    }
+    std::string move = engine.Move(board.getFen(), limits);
+    board.makeMove(chess::uci::uciToMove(board, move));
+  }
+  return 0.5;
+}
+
+// White's mean self-play score below a position; fills in the edge statistics
+double Backup(uint64_t hash, std::map<uint64_t, Node> &nodes,
+              const std::map<uint64_t, double> &playouts,
+              std::map<uint64_t, std::pair<double, uint32_t>> &memo,
+              std::set<uint64_t> &path) {
+  if (auto it = memo.find(hash); it != memo.end())
+    return it->second.first;
+  auto node = nodes.find(hash);
+  if (node == nodes.end() || path.count(hash)) {
+    auto playout = playouts.find(hash);
+    double value = playout != playouts.end() ? playout->second : 0.5;
+    memo[hash] = {value, playout != playouts.end() ? 1u : 0u};
+    return value;
+  }
+
+  path.insert(hash);
+  bool white =
+      chess::Board(node->second.fen).sideToMove() == chess::Color::WHITE;
+  double sum = 0;
+  uint32_t games = 0;
+  for (Edge &edge : node->second.edges) {
+    double value = Backup(edge.child, nodes, playouts, memo, path);
+    edge.games = memo[edge.child].second;
+    edge.selfPlay = white ? value : 1.0 - value;
+    sum += value * std::max(1u, edge.games);
+    games += std::max(1u, edge.games);
+  }
+  path.erase(hash);
+
+  double value = games > 0 ? sum / games : 0.5;
+  memo[hash] = {value, games};
+  return value;
+}
+
+bool WriteBook(const std::string &path,
+               const std::map<uint64_t, Node> &nodes,
+               const BookConfig &config) {
+  std::vector<OpeningBook::Entry> entries;
+  for (const auto &[hash, node] : nodes) {
+    for (const Edge &edge : node.edges) {
+      bool best = &edge == &node.edges.front(); // always keep the search's choice
+      if (!best && edge.games > 0 && edge.selfPlay < config.minScore)
+        continue;
+      OpeningBook::Entry entry;
+      entry.key = hash;
+      entry.move = edge.move;
+      entry.score = int16_t(std::clamp(edge.score, -32000, 32000));
+      entry.weight = edge.games;
+      entries.push_back(entry);
+    }
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const OpeningBook::Entry &a, const OpeningBook::Entry &b) {
+              if (a.key != b.key)
+                return a.key < b.key;
+              return a.score != b.score ? a.score > b.score
+                                        : a.weight > b.weight;
+            });
+
+  OpeningBook::Header header = {};
+  std::copy(std::begin(OpeningBook::MAGIC), std::end(OpeningBook::MAGIC),
+            header.magic);
+  header.version = OpeningBook::VERSION;
+  header.entrySize = sizeof(OpeningBook::Entry);
+  header.hashScheme = HashSchemeFingerprint();
+  header.count = entries.size();
+
+  // write a temporary file and rename it, so a reader never sees half a book
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               entries.size() * sizeof(OpeningBook::Entry));
+    if (!file)
+      return false;
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error)
+    return false;
+
+  std::printf("wrote %zu moves for %zu positions to %s\n", entries.size(),
+              nodes.size(), path.c_str());
+  return true;
+}
+
+// ---------------------------------------- main ---------------------------------------- //
+
+void PrintUsage() {
+  std::cerr
+      << "usage: chessbook --out <book.bin> [options]\n"
+         "  --plies <n>          depth of the opening tree (default 12)\n"
+         "  --depth <n>          search depth per position (default 9)\n"
+         "  --multipv <n>        candidate moves per position (default 4)\n"
+         "  --margin <cp>        keep moves within this of the best "
+         "(default 30)\n"
+         "  --threads <n>        parallel searches (default: all cores)\n"
+         "  --playout-depth <n>  search depth of the self-play games "
+         "(default 3)\n"
+         "  --min-score <x>      drop moves scoring below x in self-play "
+         "(default 0.35)\n"
+         "Progress is journaled to <book.bin>.journal; rerun to resume.\n";
+}
+
+bool ParseArgs(int argc, char *argv[], BookConfig &config) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "missing value for " << arg << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+    if (arg == "--out")
+      config.out = value;
+    else if (arg == "--plies")
+      config.plies = std::max(1, std::stoi(value));
+    else if (arg == "--depth")
+      config.depth = std::max(1, std::stoi(value));
+    else if (arg == "--multipv")
+      config.multiPV = std::max(1, std::stoi(value));
+    else if (arg == "--margin")
+      config.margin = std::max(0, std::stoi(value));
+    else if (arg == "--threads")
+      config.threads = std::max(1, std::stoi(value));
+    else if (arg == "--playout-depth")
+      config.playoutDepth = std::max(1, std::stoi(value));
+    else if (arg == "--min-score")
+      config.minScore = std::stod(value);
+    else {
+      std::cerr << "unknown argument: " << arg << std::endl;
+      return false;
+    }
+  }
+  return !config.out.empty();
+}
+
+int main(int argc, char *argv[]) {
+  BookConfig config;
+  if (!ParseArgs(argc, argv, config)) {
+    PrintUsage();
+    return 1;
+  }
+  MemoryBudget::Global().SetConcurrency(config.threads);
+
+  Journal journal(config.out + ".journal");
+  std::map<uint64_t, Node> nodes;
+  std::map<uint64_t, double> playouts;
+  journal.Load(nodes, playouts);
+  if (!nodes.empty())
+    std::printf("resuming: %zu positions and %zu playouts from the journal\n",
+                nodes.size(), playouts.size());
+
+  // Expand the tree one ply at a time //
+  std::mutex mutex;
+  std::vector<std::string> frontier = {chess::constants::STARTPOS};
+  std::set<uint64_t> seen = {chess::Board(frontier[0]).hash()};
+  std::vector<std::string> leaves;
+  for (int ply = 0; ply < config.plies && !frontier.empty(); ply++) {
+    std::vector<std::string> todo;
+    for (const std::string &fen : frontier)
+      if (!nodes.count(chess::Board(fen).hash()))
+        todo.push_back(fen);
+
+    auto start = std::chrono::steady_clock::now();
+    Parallel(todo.size(), config.threads, [&](size_t i, NegaMax &engine) {
+      Node node = Expand(todo[i], ply, engine, config);
+      journal.Expanded(node);
+      std::lock_guard<std::mutex> lock(mutex);
+      nodes[chess::Board(node.fen).hash()] = std::move(node);
+    });
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::printf("ply %2d: %zu positions (%zu searched in %.1fs)\n", ply,
+                frontier.size(), todo.size(), seconds);
+    std::fflush(stdout);
+
+    // children of this ply form the next one; the last ply's are the leaves
+    std::vector<std::string> next;
+    for (const std::string &fen : frontier) {
+      chess::Board board(fen);
+      for (const Edge &edge : nodes[board.hash()].edges) {
+        if (!seen.insert(edge.child).second)
+          continue; // transposition
+        chess::Move move = chess::uci::uciToMove(board, edge.uci);
+        board.makeMove(move);
+        (ply + 1 < config.plies ? next : leaves).push_back(board.getFen());
+        board.unmakeMove(move);
+      }
+    }
+    frontier = std::move(next);
+  }
+
+  // Self-play games from the leaves //
+  std::vector<std::string> todo;
+  for (const std::string &fen : leaves)
+    if (!playouts.count(chess::Board(fen).hash()))
+      todo.push_back(fen);
+  std::printf("self-play: %zu leaves (%zu to play)\n", leaves.size(),
+              todo.size());
+  std::fflush(stdout);
+  Parallel(todo.size(), config.threads, [&](size_t i, NegaMax &engine) {
+    double result = PlayOut(todo[i], engine, config);
+    journal.PlayedOut(todo[i], result);
+    std::lock_guard<std::mutex> lock(mutex);
+    playouts[chess::Board(todo[i]).hash()] = result;
+  });
+
+  // Score every book move by the games below it, prune and write //
+  std::map<uint64_t, std::pair<double, uint32_t>> memo;
+  std::set<uint64_t> path;
+  Backup(chess::Board(chess::constants::STARTPOS).hash(), nodes, playouts,
+         memo, path);
+  return WriteBook(config.out, nodes, config) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#include "book.h"
+#include <algorithm>
+#include <cstring>
+#include "hash-scheme.h"
+
+bool OpeningBook::Open(const std::string& path) {
+    block = MemoryBlock();
+    entries = nullptr;
+    count = 0;
+
+    MemoryBlock mapped = MemoryBudget::Global().MapFile(MemoryComponent::MAPPINGS, path, 0, false);
+    if(sizeof(Header) > mapped.Size()) { return false; }
+
+    const Header* header = mapped.As<const Header>();
+    bool valid = 0 == std::memcmp(header->magic, MAGIC, sizeof(MAGIC))
+        && VERSION == header->version
+        && sizeof(Entry) == header->entrySize
+        && HashSchemeFingerprint() == header->hashScheme
+        && sizeof(Header) + header->count * sizeof(Entry) <= mapped.Size();
+    if(!valid) { return false; }
+
+    count = header->count;
+    entries = reinterpret_cast<const Entry*>(mapped.As<const char>() + sizeof(Header));
+    block = std::move(mapped);
+    return true;
+}
+
+std::string OpeningBook::Probe(const chess::Board& board) const {
+    if(0 == count) { return ""; }
+
+    uint64_t key = board.hash();
+    const Entry* first = std::lower_bound(entries, entries + count, key,
+        [](const Entry& entry, uint64_t key) { return entry.key < key; });
+
+    // Entries of a position are stored best first; skip any that aren't legal (key collision) //
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+    for(const Entry* entry = first; entry != entries + count && key == entry->key; entry++) {
+        for(int i = 0; i < moves.size(); i++) {
+            if(moves[i].move() == entry->move) { return chess::uci::moveToUci(moves[i]); }
+        }
+    }
+    return "";
+}
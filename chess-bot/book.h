@@ -0,0 +1,45 @@
+// Opening book: a sorted array of (position key, move) entries, memory-mapped
+// and searched by binary search, so opening it costs nothing and probing is
+// a handful of cache misses. Built offline by chessbook.
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include "chess.hpp"
+#include "memory-budget.h"
+
+class OpeningBook {
+public:
+    // On-disk layout: Header, then Entry[count] sorted by key (then best first)
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t entrySize;
+        uint64_t hashScheme; // HashSchemeFingerprint() of the builder
+        uint64_t count;
+    };
+
+    struct Entry {
+        uint64_t key;    // Zobrist hash of the position
+        uint16_t move;   // chess::Move encoding
+        int16_t score;   // centipawns for the side to move, from the builder's search
+        uint32_t weight; // self-play games through this move
+    };
+    static_assert(16 == sizeof(Entry), "entries are written as raw 16-byte records");
+
+    static constexpr char MAGIC[8] = "CHESSBK";
+    static constexpr uint32_t VERSION = 1;
+
+    // Map a book file; false (and an empty book) if it is missing or invalid
+    bool Open(const std::string& path);
+    bool Loaded() const { return 0 < count; }
+    uint64_t Size() const { return count; }
+
+    // Best book move in UCI, or "" when the position isn't in the book
+    std::string Probe(const chess::Board& board) const;
+
+private:
+    MemoryBlock block;
+    const Entry* entries = nullptr;
+    uint64_t count = 0;
+};
@@ -6,14 +6,70 @@
 #include "randombot.h"
 #include "negamax.h"
 #include "mcts.h"
+#include "book.h"
+#include "trace.h"
+#include <cstdlib>
 
 using namespace ChessSimulator;
 
 //RandomBot randomBot;
-NegaMax negamax;
-MCTS mcts;
 
-std::string ChessSimulator::Move(std::string fen, int timeLimitMS) {
+// Built on first use rather than before main(), so the engines (and the tables
+// they size from the memory budget) see the caller's budget settings.
+// The only engine that maps CHESS_TT_FILE (or SetTTFile's file).
+NegaMax& Negamax() {
+  static NegaMax negamax;
+  static bool configured = [] {
+    // an NNUE network compiled in with CHESS_NNUE_EMBED_FILE replaces the PST eval
+    negamax.SetNetwork(NNUENetwork::Embedded());
+    const char* path = std::getenv("CHESS_TT_FILE");
+    if (nullptr != path && '\0' != path[0]) {
+      negamax.UseTTFile(path, MemoryBudget::Global().Share(MemoryComponent::TT));
+    }
+    negamax.Prepare(); // the first move's clock doesn't pay for the table
+    return true;
+  }();
+  (void)configured;
+  return negamax;
+}
+
+MCTS& Mcts() {
+  static MCTS mcts;
+  static bool configured = [] {
+    mcts.Prepare(); // the first move's clock doesn't pay for the graph
+    return true;
+  }();
+  (void)configured;
+  return mcts;
+}
+
+// opening book from CHESS_BOOK_FILE (or SetBookFile), built with chessbook
+OpeningBook& Book() {
+  static OpeningBook book = [] {
+    OpeningBook opened;
+    const char* path = std::getenv("CHESS_BOOK_FILE");
+    if (nullptr != path) { opened.Open(path); }
+    return opened;
+  }();
+  return book;
+}
+
+// every searched node, for chesstree, when CHESS_TREE_FILE is set
+TreeRecorder* Recorder() {
+  static TreeRecorder recorder;
+  static bool opened = [] {
+    const char* path = std::getenv("CHESS_TREE_FILE");
+    return nullptr != path && recorder.Open(path);
+  }();
+  return opened ? &recorder : nullptr;
+}
+
+std::string ChessSimulator::Move(std::string fen, int timeLimitMS, const std::atomic<bool>* stop) {
+  // the competition budget is fixed at 1000ms regardless of timeLimitMS
+  return Move(fen, SearchLimits::MoveTime(1000, stop));
+}
+
+std::string ChessSimulator::Move(std::string fen, const SearchLimits& limits) {
   // create your board based on the board string following the FEN notation
   // search for the best move using minimax / monte carlo tree search /
   // alpha-beta pruning / ... try to use nice heuristics to speed up the search
@@ -24,10 +80,32 @@ std::string ChessSimulator::Move(std::string fen, int timeLimitMS) {
   /*
   // Code for alternating chessbots
   chess::Board board(fen);
-  if(board.sideToMove() == chess::Color::BLACK) { return negamax.Move(fen, 1000); }
-  else if(board.sideToMove() == chess::Color::WHITE) { return mcts.Move(fen, 1000); }
+  if(board.sideToMove() == chess::Color::BLACK) { return Negamax().Move(fen, limits); }
+  else if(board.sideToMove() == chess::Color::WHITE) { return Mcts().Move(fen, limits); }
   else { return ""; } // chess::Color::NONE is a thing for some reason, so this handles that
   */
 
-  return negamax.Move(fen, 1000); // this one seems to be better, use for midterm tournament
+  // book moves are instant and were searched far deeper offline
+  std::string bookMove = Book().Probe(chess::Board(fen));
+  if (!bookMove.empty()) { return bookMove; }
+
+  NegaMax& negamax = Negamax();
+  negamax.SetRecorder(Recorder());
+
+  std::string move = negamax.Move(fen, limits); // this one seems to be better, use for midterm tournament
+  CHESS_TRACE_END_MOVE(); // per-function profile of this move (CHESS_TRACE builds only)
+  return move;
+}
+
+void ChessSimulator::SetTelemetry(TelemetryRing* ring) {
+  Negamax().SetTelemetry(ring);
+  Mcts().SetTelemetry(ring);
+}
+
+bool ChessSimulator::SetTTFile(const std::string& path, size_t bytes) {
+  return Negamax().UseTTFile(path, bytes);
+}
+
+bool ChessSimulator::SetBookFile(const std::string& path) {
+  return Book().Open(path);
 }
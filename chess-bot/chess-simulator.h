@@ -1,12 +1,55 @@
 #pragma once
+#include <atomic>
 #include <string>
+#include "search-limits.h"
+#include "telemetry.h"
 
 namespace ChessSimulator {
 /**
  * @brief Move a piece on the board
  *
  * @param fen The board as FEN
+ * @param timeLimitMS Time budget for the move
+ * @param stop Optional flag another thread can set to end the search early
  * @return std::string The move as UCI
  */
-std::string Move(std::string fen, int timeLimitMS = 10000);
+std::string Move(std::string fen, int timeLimitMS = 10000,
+                 const std::atomic<bool> *stop = nullptr);
+
+/**
+ * @brief Move a piece on the board under explicit search limits
+ *
+ * @param fen The board as FEN
+ * @param limits Depth/nodes/time/clock/infinite limits and the stop flag
+ * @return std::string The move as UCI
+ */
+std::string Move(std::string fen, const SearchLimits &limits);
+
+/**
+ * @brief Stream live search samples into a ring buffer (nullptr disables)
+ *
+ * @param ring Single-producer/single-consumer buffer drained by the caller
+ */
+void SetTelemetry(TelemetryRing *ring);
+
+/**
+ * @brief Keep the search's transposition table in a memory-mapped file so the
+ * next process (the harness starts one per move) starts with its results.
+ * Setting CHESS_TT_FILE in the environment does the same. Only this engine
+ * maps the file; other engines in the process keep their tables in memory.
+ *
+ * @param path Table file, created or resized as needed
+ * @param bytes Size of the table
+ * @return false if the file couldn't be mapped (the in-memory table is kept)
+ */
+bool SetTTFile(const std::string &path, size_t bytes);
+
+/**
+ * @brief Play moves from an opening book built by chessbook while the
+ * position is in it (CHESS_BOOK_FILE in the environment does the same)
+ *
+ * @param path Book file
+ * @return false if the file is missing or not a valid book
+ */
+bool SetBookFile(const std::string &path);
 } // namespace ChessSimulator
\ No newline at end of file
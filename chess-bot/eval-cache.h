@@ -0,0 +1,51 @@
+// Lossy, direct-mapped cache of static evaluations keyed by position hash
+// https://www.chessprogramming.org/Evaluation_Hash_Table
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include "memory-budget.h"
+
+class EvalCache {
+public:
+    explicit EvalCache(size_t bytes = MemoryBudget::Global().Share(MemoryComponent::EVAL_CACHE))
+        : block(MemoryBudget::Global().Allocate(MemoryComponent::EVAL_CACHE, bytes)) {
+        size_t count = block.Size() / sizeof(std::atomic<uint64_t>);
+        slots = block.As<std::atomic<uint64_t>>();
+        for(size_t i = 0; i < count; i++) { new (&slots[i]) std::atomic<uint64_t>(0); }
+        mask = count - 1;
+    }
+
+    // One cache shared by every search thread in the process
+    static EvalCache& Shared() {
+        static EvalCache cache;
+        return cache;
+    }
+
+    // Each slot packs the upper 32 bits of the hash with the 32-bit score into a single
+    // atomic word, so readers never see a torn entry and no locking is needed.
+    // Colliding positions simply overwrite each other.
+    bool Probe(uint64_t hash, int& score) const {
+        uint64_t data = slots[hash & mask].load(std::memory_order_relaxed);
+        if((data & KEY_MASK) != (hash & KEY_MASK)) { return false; }
+        score = static_cast<int32_t>(static_cast<uint32_t>(data));
+        return true;
+    }
+
+    void Store(uint64_t hash, int score) {
+        uint64_t data = (hash & KEY_MASK) | static_cast<uint32_t>(score);
+        slots[hash & mask].store(data, std::memory_order_relaxed);
+    }
+
+    void Clear() {
+        for(uint64_t i = 0; i <= mask; i++) { slots[i].store(0, std::memory_order_relaxed); }
+    }
+
+private:
+    static constexpr uint64_t KEY_MASK = 0xFFFFFFFF00000000ULL;
+
+    MemoryBlock block;
+    std::atomic<uint64_t>* slots;
+    uint64_t mask;
+};
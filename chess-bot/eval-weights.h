@@ -0,0 +1,93 @@
+// Generated by chesstune; rerun it instead of editing by hand.
+// Source: Simplified Evaluation Function (Tomasz Michniewski) textbook values, untuned
+//
+// Material and piece-square tables in centipawns, from white's point of view:
+// index 0 == a1, rank 1 first. Black pieces read square ^ 56.
+
+#pragma once
+
+namespace EvalWeights {
+inline constexpr int VALUE_PAWN = 100;
+inline constexpr int VALUE_KNIGHT = 320;
+inline constexpr int VALUE_BISHOP = 330;
+inline constexpr int VALUE_ROOK = 500;
+inline constexpr int VALUE_QUEEN = 900;
+inline constexpr int VALUE_KING = 20000;
+
+inline constexpr int PST_PAWN[64] = {
+       0,    0,    0,    0,    0,    0,    0,    0,
+       5,   10,   10,  -20,  -20,   10,   10,    5,
+       5,   -5,  -10,    0,    0,  -10,   -5,    5,
+       0,    0,    0,   20,   20,    0,    0,    0,
+       5,    5,   10,   25,   25,   10,    5,    5,
+      10,   10,   20,   30,   30,   20,   10,   10,
+      50,   50,   50,   50,   50,   50,   50,   50,
+       0,    0,    0,    0,    0,    0,    0,    0,
+};
+
+inline constexpr int PST_KNIGHT[64] = {
+     -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+     -40,  -20,    0,    5,    5,    0,  -20,  -40,
+     -30,    5,   10,   15,   15,   10,    5,  -30,
+     -30,    0,   15,   20,   20,   15,    0,  -30,
+     -30,    5,   15,   20,   20,   15,    5,  -30,
+     -30,    0,   10,   15,   15,   10,    0,  -30,
+     -40,  -20,    0,    0,    0,    0,  -20,  -40,
+     -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+};
+
+inline constexpr int PST_BISHOP[64] = {
+     -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+     -10,    5,    0,    0,    0,    0,    5,  -10,
+     -10,   10,   10,   10,   10,   10,   10,  -10,
+     -10,    0,   10,   10,   10,   10,    0,  -10,
+     -10,    5,    5,   10,   10,    5,    5,  -10,
+     -10,    0,    5,   10,   10,    5,    0,  -10,
+     -10,    0,    0,    0,    0,    0,    0,  -10,
+     -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+};
+
+inline constexpr int PST_ROOK[64] = {
+       0,    0,    0,    5,    5,    0,    0,    0,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+      -5,    0,    0,    0,    0,    0,    0,   -5,
+       5,   10,   10,   10,   10,   10,   10,    5,
+       0,    0,    0,    0,    0,    0,    0,    0,
+};
+
+inline constexpr int PST_QUEEN[64] = {
+     -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+     -10,    0,    5,    0,    0,    0,    0,  -10,
+     -10,    5,    5,    5,    5,    5,    0,  -10,
+       0,    0,    5,    5,    5,    5,    0,   -5,
+      -5,    0,    5,    5,    5,    5,    0,   -5,
+     -10,    0,    5,    5,    5,    5,    0,  -10,
+     -10,    0,    0,    0,    0,    0,    0,  -10,
+     -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+};
+
+inline constexpr int PST_KING[64] = {
+      20,   30,   10,    0,    0,   10,   30,   20,
+      20,   20,    0,    0,    0,    0,   20,   20,
+     -10,  -20,  -20,  -20,  -20,  -20,  -20,  -10,
+     -20,  -30,  -30,  -40,  -40,  -30,  -30,  -20,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+     -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+};
+
+inline constexpr int PST_KING_END[64] = {
+     -50,  -30,  -30,  -30,  -30,  -30,  -30,  -50,
+     -30,  -30,    0,    0,    0,    0,  -30,  -30,
+     -30,  -10,   20,   30,   30,   20,  -10,  -30,
+     -30,  -10,   30,   40,   40,   30,  -10,  -30,
+     -30,  -10,   30,   40,   40,   30,  -10,  -30,
+     -30,  -10,   20,   30,   30,   20,  -10,  -30,
+     -30,  -20,  -10,    0,    0,  -10,  -20,  -30,
+     -50,  -40,  -30,  -20,  -20,  -30,  -40,  -50,
+};
+} // namespace EvalWeights
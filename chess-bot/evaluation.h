@@ -3,19 +3,50 @@
 // Implementation based (very loosely) on Python implementation by Andrew Healey
 // https://healeycodes.com/building-my-own-chess-engine
 
+#pragma once
+#include <algorithm>
 #include <limits>
 #include "chess.hpp"
+#include "eval-weights.h"
+#include "pawn-structure.h"
+#include "trace.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 class Eval {
 public:
     const int MATE = 100000;
     const int INF  = 999999;
 
+    Eval() {
+        // material + PST for every piece (chess::Piece order) on every square, from white's
+        // perspective, with a zero row for Piece::NONE; [1] uses the endgame king table
+        using namespace EvalWeights;
+        const int* tables[6] = { PST_PAWN, PST_KNIGHT, PST_BISHOP, PST_ROOK, PST_QUEEN, PST_KING };
+        const int values[6] = { VALUE_PAWN, VALUE_KNIGHT, VALUE_BISHOP, VALUE_ROOK, VALUE_QUEEN, VALUE_KING };
+        for(int endgame = 0; endgame < 2; endgame++) {
+            for(int piece = 0; piece < 12; piece++) {
+                int type = piece % 6;
+                const int* table = endgame && 5 == type ? PST_KING_END : tables[type];
+                bool white = piece < 6;
+                for(int i = 0; i < 64; i++) {
+                    int value = values[type] + table[white ? i : i ^ 56];
+                    pieceSquare[endgame][piece * 64 + i] = white ? value : -value;
+                }
+            }
+            std::fill_n(&pieceSquare[endgame][NONE_ROW], 64, 0);
+        }
+    }
+
     int Evaluate(chess::Board& board) {
+        CHESS_TRACE_SCOPE("Eval::Evaluate");
         // check checkmate
         chess::GameResult result = board.isGameOver().second;
         if(chess::GameResult::LOSE == result) { return -MATE; }
 
+        using namespace EvalWeights;
         bool endgame = IsEndgame(board);
         //int phase = CalculatePhase(board);
         int score = 0;
@@ -25,51 +56,125 @@ public:
             piece = board.at(i);
             switch(piece.internal()) {
                 case chess::Piece::WHITEPAWN:
-                    score += VALUE_PAWN + PST_PAWN_WHITE[i];
+                    score += VALUE_PAWN + PST_PAWN[i];
                     break;
                 case chess::Piece::BLACKPAWN:
-                    score -= VALUE_PAWN + PST_PAWN_BLACK[i];
+                    score -= VALUE_PAWN + PST_PAWN[i ^ 56];
                     break;
                 case chess::Piece::WHITEKNIGHT:
                     score += VALUE_KNIGHT + PST_KNIGHT[i];
                     break;
                 case chess::Piece::BLACKKNIGHT:
-                    score -= VALUE_KNIGHT + PST_KNIGHT[i];
+                    score -= VALUE_KNIGHT + PST_KNIGHT[i ^ 56];
                     break;
                 case chess::Piece::WHITEBISHOP:
-                    score += VALUE_BISHOP + PST_BISHOP_WHITE[i];
+                    score += VALUE_BISHOP + PST_BISHOP[i];
                     break;
                 case chess::Piece::BLACKBISHOP:
-                    score -= VALUE_BISHOP + PST_BISHOP_BLACK[i];
+                    score -= VALUE_BISHOP + PST_BISHOP[i ^ 56];
                     break;
                 case chess::Piece::WHITEROOK:
-                    score += VALUE_ROOK + PST_ROOK_WHITE[i];
+                    score += VALUE_ROOK + PST_ROOK[i];
                     break;
                 case chess::Piece::BLACKROOK:
-                    score -= VALUE_ROOK + PST_ROOK_BLACK[i];
+                    score -= VALUE_ROOK + PST_ROOK[i ^ 56];
                     break;
                 case chess::Piece::WHITEQUEEN:
                     score += VALUE_QUEEN + PST_QUEEN[i];
                     break;
                 case chess::Piece::BLACKQUEEN:
-                    score -= VALUE_QUEEN + PST_QUEEN[i];
+                    score -= VALUE_QUEEN + PST_QUEEN[i ^ 56];
                     break;
                 case chess::Piece::WHITEKING:
-                    score += VALUE_KING + endgame ? PST_KING_WHITE_END[i] : PST_KING_WHITE[i];
-                    //score += VALUE_KING + TaperedEval(phase, PST_KING_WHITE[i], PST_KING_WHITE_END[i]);
+                    score += VALUE_KING + (endgame ? PST_KING_END[i] : PST_KING[i]);
+                    //score += VALUE_KING + TaperedEval(phase, PST_KING[i], PST_KING_END[i]);
                     break;
                 case chess::Piece::BLACKKING:
-                    score -= VALUE_KING + endgame ? PST_KING_BLACK_END[i] : PST_KING_BLACK[i];
-                    //score -= VALUE_KING + TaperedEval(phase, PST_KING_BLACK[i], PST_KING_BLACK_END[i]);
+                    score -= VALUE_KING + (endgame ? PST_KING_END[i ^ 56] : PST_KING[i ^ 56]);
+                    //score -= VALUE_KING + TaperedEval(phase, PST_KING[i ^ 56], PST_KING_END[i ^ 56]);
                     break;
                 default: break;
             }
         }
+
+        // pawn structure (doubled, isolated, backward, passed) comes from the pawn hash table
+        score += pawnTable.Probe(board);
         
         return board.sideToMove() == chess::Color::WHITE ? score : -score;
     }
 
+    // Scores of the positions after each of `moves`, for the side making them, without playing
+    // the moves: the parent's material + PST plus each move's delta, which is what it removes
+    // from and adds to the board looked up in pieceSquare. The lookups are laid out as
+    // structure-of-arrays so eight moves go through one set of AVX2 gathers.
+    // Approximate: the parent's pawn structure and game phase carry over and mates aren't seen.
+    void EvaluateBatch(const chess::Board& board, const chess::Move* moves, int count, int* scores) {
+        CHESS_TRACE_SCOPE("Eval::EvaluateBatch");
+        const int* table = pieceSquare[IsEndgame(board) ? 1 : 0];
+        int parent = pawnTable.Probe(board);
+        for(int i = 0; i < 64; i++) { parent += table[static_cast<int>(board.at(i).internal()) * 64 + i]; }
+        bool white = board.sideToMove() == chess::Color::WHITE;
+        int own = white ? 0 : 6; // first piece of the mover's color
+
+        for(int start = 0; start < count; start += BATCH) {
+            int batch = std::min(BATCH, count - start);
+
+            // Table indices: the mover and a captured piece (or castling rook) leave, the mover (or
+            // promoted piece) and the rook arrive. Unused slots point at the NONE row.
+            alignas(32) int removed[2][BATCH];
+            alignas(32) int added[2][BATCH];
+            for(int i = 0; i < batch; i++) {
+                chess::Move move = moves[start + i];
+                int from = move.from().index(), to = move.to().index();
+                int piece = static_cast<int>(board.at(from).internal());
+                removed[0][i] = piece * 64 + from;
+                removed[1][i] = static_cast<int>(board.at(to).internal()) * 64 + to;
+                added[0][i] = piece * 64 + to;
+                added[1][i] = NONE_ROW;
+                switch(move.typeOf()) {
+                    case chess::Move::PROMOTION:
+                        added[0][i] = (own + static_cast<int>(move.promotionType().internal())) * 64 + to;
+                        break;
+                    case chess::Move::ENPASSANT:
+                        removed[1][i] = (6 - own) * 64 + (white ? to - 8 : to + 8); // the pawn behind the target square
+                        break;
+                    case chess::Move::CASTLING: { // encoded as king takes own rook
+                        int rank = from & ~7;
+                        bool kingSide = to > from;
+                        added[0][i] = piece * 64 + rank + (kingSide ? 6 : 2);
+                        added[1][i] = removed[1][i] - to + rank + (kingSide ? 5 : 3);
+                        break;
+                    }
+                    default: break;
+                }
+            }
+
+            int* out = scores + start;
+            int i = 0;
+#if defined(__AVX2__)
+            const __m256i parentScore = _mm256_set1_epi32(parent);
+            const __m256i negate = _mm256_set1_epi32(white ? 0 : -1); // (x ^ -1) - -1 == -x
+            for(; i + 8 <= batch; i += 8) {
+                __m256i gain = _mm256_add_epi32(
+                    _mm256_i32gather_epi32(table, _mm256_load_si256(reinterpret_cast<const __m256i*>(&added[0][i])), 4),
+                    _mm256_i32gather_epi32(table, _mm256_load_si256(reinterpret_cast<const __m256i*>(&added[1][i])), 4));
+                __m256i loss = _mm256_add_epi32(
+                    _mm256_i32gather_epi32(table, _mm256_load_si256(reinterpret_cast<const __m256i*>(&removed[0][i])), 4),
+                    _mm256_i32gather_epi32(table, _mm256_load_si256(reinterpret_cast<const __m256i*>(&removed[1][i])), 4));
+                __m256i score = _mm256_add_epi32(parentScore, _mm256_sub_epi32(gain, loss));
+                score = _mm256_sub_epi32(_mm256_xor_si256(score, negate), negate);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), score);
+            }
+#endif
+            for(; i < batch; i++) {
+                int score = parent + table[added[0][i]] + table[added[1][i]] - table[removed[0][i]] - table[removed[1][i]];
+                out[i] = white ? score : -score;
+            }
+        }
+    }
+
     int PieceValue(chess::PieceType piece) {
+        using namespace EvalWeights;
         switch(piece.internal()) {
             case chess::PieceType::PAWN: return VALUE_PAWN;
             case chess::PieceType::KNIGHT: return VALUE_KNIGHT;
@@ -81,8 +186,12 @@ public:
         }
     }
 
-private:
-    bool IsEndgame(chess::Board& board) {
+    const PawnTable& Pawns() const { return pawnTable; }
+
+    // Pawn structure term of Evaluate(), from white's perspective
+    int PawnStructure(const chess::Board& board) { return pawnTable.Probe(board); }
+
+    bool IsEndgame(const chess::Board& board) {
         // Michniewski's definition
         // 1) Both sides have no queens
         // 2) Each side that has a queen has one minor piece max
@@ -109,6 +218,14 @@ private:
         return !((wQueens && 1 < wMinors) || (bQueens && 1 < bMinors));
     }
 
+private:
+    PawnTable pawnTable;
+
+    // Material + PST lookup for EvaluateBatch(), [endgame][piece * 64 + square]
+    static constexpr int NONE_ROW = 12 * 64;
+    static constexpr int BATCH = 64;
+    int pieceSquare[2][13 * 64];
+
     int TaperedEval(int phase, int mg, int eg) { return (mg * phase + eg * (24 - phase)) / 24; }
 
     int CalculatePhase(chess::Board& board) {
@@ -122,143 +239,21 @@ private:
 
         return phase;
     }
-    
-    const int VALUE_PAWN = 100;
-    const int VALUE_KNIGHT = 320;
-    const int VALUE_BISHOP = 330;
-    const int VALUE_ROOK = 500;
-    const int VALUE_QUEEN = 900;
-    const int VALUE_KING = 20000;
-
-    const int PST_PAWN_BLACK[64] = {
-         0,  0,   0,   0,  0,   0,  0,  0,
-        50, 50,  50,  50, 50,  50, 50, 50,
-        10, 10,  20,  30, 30,  20, 10, 10,
-         5,  5,  10,  25, 25,  10,  5,  5,
-         0,  0,   0,  20, 20,   0,  0,  0,
-         5, -5, -10,   0,  0, -10, -5,  5,
-         5, 10,  10, -20,-20,  10, 10,  5,
-         0,  0,   0,   0,  0,   0,  0,  0
-    };
-
-    const int PST_PAWN_WHITE[64] = {
-         0,  0,   0,   0,   0,   0,  0,  0,
-         5, 10,  10, -20, -20,  10, 10,  5,
-         5, -5, -10,   0,   0, -10, -5,  5,
-         0,  0,   0,  20,  20,   0,  0,  0,
-         5,  5,  10,  25,  25,  10,  5,  5,
-        10, 10,  20,  30,  30,  20, 10, 10,
-        50, 50,  50,  50,  50,  50, 50, 50,
-         0,  0,   0,   0,   0,   0,  0,  0
-    };
-
-    const int PST_KNIGHT[64] = {
-        -50, -40, -30, -30, -30, -30, -40, -50,
-        -40, -20,   0,   0,   0,   0, -20, -40,
-        -30,   0,  10,  15,  15,  10,   0, -30,
-        -30,   5,  15,  20,  20,  15,   5, -30,
-        -30,   0,  15,  20,  20,  15,   0, -30,
-        -30,   5,  10,  15,  15,  10,   5, -30,
-        -40, -20,   0,   5,   5,   0, -20, -40,
-        -50, -40, -30, -30, -30, -30, -40, -50
-    };
-
-    const int PST_BISHOP_BLACK[64] = {
-        -20, -10, -10, -10, -10, -10, -10, -20,
-        -10,   0,   0,   0,   0,   0,   0, -10,
-        -10,   0,   5,  10,  10,   5,   0, -10,
-        -10,   5,   5,  10,  10,   5,   5, -10,
-        -10,   0,  10,  10,  10,  10,   0, -10,
-        -10,  10,  10,  10,  10,  10,  10, -10,
-        -10,   5,   0,   0,   0,   0,   5, -10,
-        -20, -10, -10, -10, -10, -10, -10, -20
-    };
-
-    const int PST_BISHOP_WHITE[64] = {
-        -20, -10, -10, -10, -10, -10, -10, -20,
-        -10,   5,   0,   0,   0,   0,   5, -10,
-        -10,  10,  10,  10,  10,  10,  10, -10,
-        -10,   0,  10,  10,  10,  10,   0, -10,
-        -10,   5,   5,  10,  10,   5,   5, -10,
-        -10,   0,   5,  10,  10,   5,   0, -10,
-        -10,   0,   0,   0,   0,   0,   0, -10,
-        -20, -10, -10, -10, -10, -10, -10, -20
-    };
-
-    const int PST_ROOK_BLACK[64] = {
-         0,  0,  0,  0,  0,  0,  0,  0,
-         5, 10, 10, 10, 10, 10, 10,  5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-         0,  0,  0,  5,  5,  0,  0,  0
-    };
-
-    const int PST_ROOK_WHITE[64] = {
-         0,  0,  0,  5,  5,  0,  0,  0,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-        -5,  0,  0,  0,  0,  0,  0, -5,
-         5, 10, 10, 10, 10, 10, 10,  5,
-         0,  0,  0,  0,  0,  0,  0,  0
-    };
-
-    const int PST_QUEEN[64] = {
-        -20,-10, -10, -5, -5, -10, -10, -20,
-        -10,  0,   0,  0,  0,   0,   0, -10,
-        -10,  0,   5,  5,  5,   5,   0, -10,
-         -5,  0,   5,  5,  5,   5,   0,  -5,
-          0,  0,   5,  5,  5,   5,   0,  -5,
-        -10,  5,   5,  5,  5,   5,   0, -10,
-        -10,  0,   5,  0,  0,   0,   0, -10,
-        -20,-10, -10, -5, -5, -10, -10, -20
-    };
-
-    const int PST_KING_BLACK[64] = {
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -20, -30, -30, -40, -40, -30, -30, -20,
-        -10, -20, -20, -20, -20, -20, -20, -10,
-         20,  20,   0,   0,   0,   0,  20,  20,
-         20,  30,  10,   0,   0,  10,  30,  20
-    };
-
-    const int PST_KING_WHITE[64] = {
-         20,  30,  10,   0,   0,  10,  30,  20,
-         20,  20,   0,   0,   0,   0,  20,  20,
-        -10, -20, -20, -20, -20, -20, -20, -10,
-         20, -30, -30, -40, -40, -30, -30, -20,
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -30, -40, -40, -50, -50, -40, -40, -30,
-        -30, -40, -40, -50, -50, -40, -40, -30
-    };
-
-    const int PST_KING_BLACK_END[64] = {
-        -50, -40, -30, -20, -20, -30, -40, -50,
-        -30, -20, -10,   0,   0, -10, -20, -30,
-        -30, -10,  20,  30,  30,  20, -10, -30,
-        -30, -10,  30,  40,  40,  30, -10, -30,
-        -30, -10,  30,  40,  40,  30, -10, -30,
-        -30, -10,  20,  30,  30,  20, -10, -30,
-        -30, -30,   0,   0,   0,   0, -30, -30,
-        -50, -30, -30, -30, -30, -30, -30, -50
-    };
-
-    const int PST_KING_WHITE_END[64] = {
-         50, -30, -30, -30, -30, -30, -30, -50,
-        -30, -30,   0,   0,   0,   0, -30, -30,
-        -30, -10,  20,  30,  30,  20, -10, -30,
-        -30, -10,  30,  40,  40,  30, -10, -30,
-        -30, -10,  30,  40,  40,  30, -10, -30,
-        -30, -10,  20,  30,  30,  20, -10, -30,
-        -30, -20, -10,   0,   0, -10, -20, -30,
-        -50, -40, -30, -20, -20, -30, -40, -50
-    };
 };
+
+// Fingerprint of the PST evaluation: FNV-1a over eval-weights.h and the pawn terms.
+// Stored with transposition table files, so regenerating the weights (chesstune)
+// invalidates the scores searched with the old ones.
+inline uint64_t EvalFingerprint() {
+    static const uint64_t fingerprint = [] {
+        using namespace EvalWeights;
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        auto mix = [&](int value) { hash = (hash ^ uint32_t(value)) * 0x100000001B3ULL; };
+        for(int value : { VALUE_PAWN, VALUE_KNIGHT, VALUE_BISHOP, VALUE_ROOK, VALUE_QUEEN, VALUE_KING }) { mix(value); }
+        for(const int* table : { PST_PAWN, PST_KNIGHT, PST_BISHOP, PST_ROOK, PST_QUEEN, PST_KING, PST_KING_END }) {
+            for(int i = 0; i < 64; i++) { mix(table[i]); }
+        }
+        return PawnTable::Fingerprint(hash);
+    }();
+    return fingerprint;
+}
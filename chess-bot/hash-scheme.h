@@ -0,0 +1,14 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include "chess.hpp"
+
+// Fingerprint of the chess library's Zobrist keys, stored in files keyed by
+// position hash (transposition table, opening book). It changes whenever the
+// library's random numbers do, which would silently invalidate those files.
+inline uint64_t HashSchemeFingerprint() {
+    uint64_t scheme = chess::Board(chess::constants::STARTPOS).hash();
+    scheme ^= std::rotl(chess::Board("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4").hash(), 17);
+    scheme ^= std::rotl(chess::Board("8/8/4k3/8/2p5/8/B2K4/8 b - - 0 1").hash(), 41);
+    return scheme;
+}
@@ -1,106 +1,329 @@
 #include "mcts.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cfloat>
+#include <deque>
+#include <numbers>
 
-// ---------------------------------------- MCTSNode ----------------------------------------//
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
-// C == sqrt(2) generally gives a good balance between exploitation and exploration
-// C == 0 yields pure exploitation, C > sqrt(2) yields more exploration
-double MCTSNode::UCB(double C) {
-    if(0 >= visits) { return std::numeric_limits<double>::max(); }
+namespace {
+// More than the legal moves of any chess position (218)
+constexpr int MAX_MOVES = 256;
 
-    // UCB1 = (wins/visits) + C*sqrt[ln(parentVisits)/visits]
-    return wins / visits + std::sqrt(std::log(parent->visits) / visits) * C;
+// ---------------------------------------- Kernels ---------------------------------------- //
+
+// UCB1 = Q + C*sqrt[ln(parentVisits)/visits] for a node's edges, FLT_MAX for unvisited ones.
+// Q is the shared child node's value, so transpositions inform every parent.
+void UCBScores(const float* q, const uint32_t* visits, int count, float logParentVisits, float C, float* scores) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256 logN = _mm256_set1_ps(logParentVisits);
+    const __m256 c = _mm256_set1_ps(C);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 unvisitedScore = _mm256_set1_ps(FLT_MAX);
+    for(; i + 8 <= count; i += 8) {
+        __m256 n = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(visits + i)));
+        __m256 unvisited = _mm256_cmp_ps(n, _mm256_setzero_ps(), _CMP_EQ_OQ);
+        __m256 explore = _mm256_sqrt_ps(_mm256_div_ps(logN, _mm256_max_ps(n, one)));
+        __m256 score = _mm256_add_ps(_mm256_loadu_ps(q + i), _mm256_mul_ps(c, explore));
+        _mm256_storeu_ps(scores + i, _mm256_blendv_ps(score, unvisitedScore, unvisited));
+    }
+#elif defined(__SSE2__)
+    const __m128 logN = _mm_set1_ps(logParentVisits);
+    const __m128 c = _mm_set1_ps(C);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 unvisitedScore = _mm_set1_ps(FLT_MAX);
+    for(; i + 4 <= count; i += 4) {
+        __m128 n = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(visits + i)));
+        __m128 unvisited = _mm_cmpeq_ps(n, _mm_setzero_ps());
+        __m128 explore = _mm_sqrt_ps(_mm_div_ps(logN, _mm_max_ps(n, one)));
+        __m128 score = _mm_add_ps(_mm_loadu_ps(q + i), _mm_mul_ps(c, explore));
+        _mm_storeu_ps(scores + i, _mm_or_ps(_mm_and_ps(unvisited, unvisitedScore), _mm_andnot_ps(unvisited, score)));
+    }
+#endif
+    for(; i < count; i++) {
+        scores[i] = 0 == visits[i] ? FLT_MAX : q[i] + C * std::sqrt(logParentVisits / float(visits[i]));
+    }
 }
 
-void MCTSNode::DeleteOtherChildren(const MCTSNode* save) {
-    while(1 < children.size()) {
-        if(save == children.back()) {
-            delete children[0];
-            children[0] = children.back();
+// ln(visits) from multiplications alone: log2 by repeatedly squaring the mantissa, one
+// bit per step (https://en.wikipedia.org/wiki/Binary_logarithm#Iterative_approximation).
+// libm's log() may round differently on another machine.
+float LogVisits(uint32_t visits) {
+    int exponent = std::bit_width(visits) - 1;
+    double mantissa = double(visits) / double(uint64_t(1) << exponent); // [1, 2)
+    double log2 = exponent;
+    double bit = 1.0;
+    for(int i = 0; i < 24; i++) {
+        mantissa *= mantissa;
+        bit *= 0.5;
+        if(2.0 <= mantissa) {
+            mantissa *= 0.5;
+            log2 += bit;
         }
-        else { delete children.back(); }
-        children.pop_back();
+    }
+    return float(log2 * std::numbers::ln2);
+}
+
+// PUCT = Q + C*P*sqrt(parentVisits)/(1 + visits). Unvisited edges keep the eval's Q until their first playout.
+void PUCTScores(const float* q, const uint32_t* visits, const float* policy, int count, float sqrtParentVisits, float C, float* scores) {
+    int i = 0;
+#if defined(__AVX2__)
+    const __m256 cSqrtN = _mm256_set1_ps(C * sqrtParentVisits);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for(; i + 8 <= count; i += 8) {
+        __m256 n = _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(visits + i)));
+        __m256 explore = _mm256_div_ps(_mm256_mul_ps(cSqrtN, _mm256_loadu_ps(policy + i)), _mm256_add_ps(one, n));
+        _mm256_storeu_ps(scores + i, _mm256_add_ps(_mm256_loadu_ps(q + i), explore));
+    }
+#elif defined(__SSE2__)
+    const __m128 cSqrtN = _mm_set1_ps(C * sqrtParentVisits);
+    const __m128 one = _mm_set1_ps(1.0f);
+    for(; i + 4 <= count; i += 4) {
+        __m128 n = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(visits + i)));
+        __m128 explore = _mm_div_ps(_mm_mul_ps(cSqrtN, _mm_loadu_ps(policy + i)), _mm_add_ps(one, n));
+        _mm_storeu_ps(scores + i, _mm_add_ps(_mm_loadu_ps(q + i), explore));
+    }
+#endif
+    for(; i < count; i++) {
+        scores[i] = q[i] + C * sqrtParentVisits * policy[i] / (1.0f + float(visits[i]));
     }
 }
+} // namespace
 
 // ---------------------------------------- MCTS (process) ---------------------------------------- //
 
-std::string MCTS::Move(const std::string& fen, int64_t timeLimitMS) {
+std::string MCTS::Move(const std::string& fen, const SearchLimits& limits) {
     // Time limit setup
     using namespace std::chrono;
+    Prepare(); // a first allocation is not charged to the clock
+    int64_t timeLimitMS = limits.TimeBudgetMS(chess::Board(fen).sideToMove()); // -1 == no time limit
+    if(0 < limits.nodes) { rng.seed(NODE_LIMIT_SEED); }
     steady_clock::time_point startTime = steady_clock::now();
     steady_clock::time_point currentTime;
     duration<int64_t, std::milli> timeElapsed;
 
-    //ReuseTree(fen); // Attempt to reuse tree
-    
-    // reusing tree causes tree to grow much larger
-    // worried about memory constraint for comp
-    if(nullptr != root) { delete root; }
-    root = new MCTSNode(fen);
+    // Reuse whatever the graph already knows about this position
+    ReuseTree(fen);
 
     // MCTS loop
-    MCTSNode* leaf;
+    uint64_t playouts = 0;
+    int64_t lastPublishMS = 0;
+    chess::Board board;
     do {
-        leaf = Select(root);
-        leaf = Expand(leaf);
-        double rolloutResult = Simulate(leaf);
-        Backpropagate(leaf, rolloutResult);
+        board = rootBoard;
+        bool repeated = Select(board);
+
+        // Expand a leaf that has been played out before (the root always), as long as memory and depth allow //
+        uint32_t leaf = pathNodes.back();
+        bool expand = !repeated && NO_NODE != leaf && !nodes[leaf].expanded && (root == leaf || 0 < nodes[leaf].visits);
+        if(expand && GraphHasRoom() && (0 >= limits.depth || (int)pathEdges.size() < limits.depth)) {
+            Expand(leaf, board);
+            if(0 < nodes[leaf].numEdges) {
+                Descend(nodes[leaf].firstEdge, board);
+                repeated = std::find(pathNodes.begin(), pathNodes.end() - 1, pathNodes.back()) != pathNodes.end() - 1;
+            }
+        }
+
+        // A position repeating on the path is a draw by the time it comes around again //
+        double rolloutResult = repeated ? 0.5 : nullptr != leafSearch ? EvaluateLeaf(board) : Simulate(board);
+        Backpropagate(rolloutResult);
+        ++playouts;
 
         currentTime = steady_clock::now();
         timeElapsed = duration_cast<duration<int64_t, std::milli>>(currentTime - startTime);
-    } while(timeElapsed.count() < timeLimitMS);
 
-    //std::cout << "Num nodes: " << NumNodes(root) << std::endl;
+        if(nullptr != telemetry && timeElapsed.count() - lastPublishMS >= TELEMETRY_INTERVAL_MS) {
+            Publish(playouts, timeElapsed.count(), false);
+            lastPublishMS = timeElapsed.count();
+        }
+    } while((0 > timeLimitMS || timeElapsed.count() < timeLimitMS)
+        && (0 == limits.nodes || playouts < limits.nodes)
+        && !limits.Stopped());
+
+    if(nullptr != telemetry) { Publish(playouts, timeElapsed.count(), true); }
 
-    // Return move to make
-    root = BestChild(root);
-    return root->move;
+    //std::cout << "Num nodes: " << nodes.size() << std::endl;
+
+    CollectLines(limits.multiPV);
+    lastPlayouts = playouts;
+    if(nullptr != recorder) { RecordTree(); }
+
+    // Return move to make; the graph is pruned to the new position at the start of the next move
+    uint32_t best = BestEdge(root);
+    if(NO_NODE == best) { return ""; }
+    return chess::uci::moveToUci(chess::Move(edges.move[best]));
 }
 
-// Select child with best UCB1 score.
-MCTSNode* MCTS::Select(MCTSNode* node) {
-    while(!node->children.empty()) {
-        node = *std::max_element(
-            node->children.begin(), node->children.end(),
-            [](MCTSNode* a, MCTSNode* b) { return a->UCB() < b->UCB(); }
-        );
+// Follow the best UCB1/PUCT edge from the root until reaching a node that hasn't been
+// expanded (or has no moves), playing the moves on `board`. Returns true when the
+// path ran into a position already on it (a repetition cycle in the graph).
+bool MCTS::Select(chess::Board& board) {
+    CHESS_TRACE_SCOPE("MCTS::Select");
+    pathNodes.assign(1, root);
+    pathEdges.clear();
+
+    uint32_t node = root;
+    while(nodes[node].expanded && 0 < nodes[node].numMoves) {
+        // Admit the next moves by prior as the node's visits grow //
+        uint16_t widened = WidenedEdges(nodes[node]);
+        if(widened > nodes[node].numEdges) { Widen(node, widened); }
+
+        uint32_t best = SelectEdge(node);
+
+        // A move played for the first time stops here: its position is the new leaf //
+        bool firstVisit = 0 == edges.visits[best];
+        Descend(best, board);
+        node = pathNodes.back();
+        if(NO_NODE == node) { break; } // the graph is full: played out without a node
+        if(std::find(pathNodes.begin(), pathNodes.end() - 1, node) != pathNodes.end() - 1) { return true; }
+        if(firstVisit) { break; }
     }
 
-    return node;
+    return false;
 }
 
-// Assumes that node has no children (should be chosen by Select()).
-MCTSNode* MCTS::Expand(MCTSNode* node) {
-    // Generate legal moves from this position
-    chess::Board board(node->state);
+// Stores the legal moves sorted by prior and gives the first few of them edges.
+// Child nodes are created (or found, for transpositions) only when a move is first played.
+void MCTS::Expand(uint32_t node, const chess::Board& board) {
+    CHESS_TRACE_SCOPE("MCTS::Expand");
     chess::Movelist moves;
-    chess::movegen::legalmoves(moves, board);
-    if(0 >= moves.size()) { return node; }
+    CHESS_TRACE_CALL("movegen", chess::movegen::legalmoves(moves, board));
+
+    // Every child scored in one batch instead of one Evaluate() per child //
+    int scores[MAX_MOVES];
+    if(evalPriors) { priorEval.EvaluateBatch(board, moves.begin(), moves.size(), scores); }
 
-    // Assign each legal move as a child node.
+    uint32_t firstMove = static_cast<uint32_t>(sortedMoves.size());
     for(int i = 0; i < moves.size(); i++) {
-        board.makeMove(moves[i]);
-        MCTSNode* child = new MCTSNode(board.getFen(), chess::uci::moveToUci(moves[i]), node);
-        node->children.push_back(child);
-        board.unmakeMove(moves[i]);
+        int16_t prior = evalPriors ? static_cast<int16_t>(std::clamp(scores[i], -32000, 32000)) : Prior(board, moves[i]);
+        sortedMoves.push_back({ moves[i].move(), prior });
     }
+    std::stable_sort(sortedMoves.begin() + firstMove, sortedMoves.end(),
+        [](const MCTSMove& a, const MCTSMove& b) { return a.prior > b.prior; });
 
-    return node->children[0];
+    nodes[node].priorSum = 0.0f;
+    if(evalPriors && !moves.empty()) {
+        int best = sortedMoves[firstMove].prior;
+        for(uint32_t i = firstMove; i < sortedMoves.size(); i++) {
+            nodes[node].priorSum += float(SoftmaxWeight(best - sortedMoves[i].prior));
+        }
+    }
+
+    nodes[node].firstMove = firstMove;
+    nodes[node].numMoves = static_cast<uint16_t>(moves.size());
+    nodes[node].firstEdge = static_cast<uint32_t>(edges.size());
+    nodes[node].numEdges = 0;
+    nodes[node].edgeCapacity = 0;
+    nodes[node].expanded = true;
+    Widen(node, WidenedEdges(nodes[node]));
 }
 
-// Rollout: Play a random game to completion and return the game's result.
-// 0.0 for loss, 0.5 for tie, 1.0 for win.
-double MCTS::Simulate(MCTSNode* node) {
-    // Set up RNG
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, 217);
+// Number of moves that should have edges at the node's visit count
+uint16_t MCTS::WidenedEdges(const MCTSNode& node) const {
+    if(node.numEdges == node.numMoves) { return node.numMoves; } // fully widened
+    double widened = WIDENING_BASE + WIDENING_FACTOR * std::sqrt(double(node.visits));
+    return static_cast<uint16_t>(std::min<double>(node.numMoves, widened));
+}
+
+// Give the node's next moves edges. Edge blocks grow by doubling; a block that
+// isn't at the end of the array moves there and leaves a hole for Compact().
+void MCTS::Widen(uint32_t node, uint16_t numEdges) {
+    MCTSNode& widening = nodes[node];
+    if(numEdges <= widening.numEdges) { return; }
+    if(numEdges > widening.edgeCapacity) {
+        uint16_t capacity = std::min<uint16_t>(widening.numMoves, std::max<uint16_t>(numEdges, 2 * widening.edgeCapacity));
+        bool atEnd = widening.firstEdge + widening.edgeCapacity == edges.size();
+        uint32_t firstEdge = atEnd ? widening.firstEdge : static_cast<uint32_t>(edges.size());
+        if(firstEdge + capacity > edges.capacity()) { return; } // the graph is full: keep the edges it has
+        if(!atEnd) {
+            for(uint32_t e = widening.firstEdge; e < widening.firstEdge + widening.numEdges; e++) { edges.PushCopy(e); }
+            widening.firstEdge = firstEdge;
+        }
+        edges.resize(widening.firstEdge + capacity);
+        widening.edgeCapacity = capacity;
+    }
 
-    // "Why 217?" 218 is the known maximum number of possible moves from a *reachable* position:
-    // https://chess.stackexchange.com/questions/4490/maximum-possible-movement-in-a-turn
+    for(uint16_t i = widening.numEdges; i < numEdges; i++) {
+        const MCTSMove& move = sortedMoves[widening.firstMove + i];
+        if(evalPriors) { edges.Set(widening.firstEdge + i, NO_NODE, move.move, Policy(widening, move), InitialQ(move)); }
+        else { edges.Set(widening.firstEdge + i, NO_NODE, move.move, move.prior, 0.0f); }
+    }
+    widening.numEdges = numEdges;
+}
+
+// Cheap move-ordering prior: captures by MVV-LVA, promotions by the new piece, quiet moves 0
+int16_t MCTS::Prior(const chess::Board& board, chess::Move move) {
+    static constexpr int VALUES[] = { 100, 320, 330, 500, 900, 0, 0 }; // by chess::PieceType, KING and NONE last
+    int prior = 0;
+    if(chess::Move::PROMOTION == move.typeOf()) { prior += VALUES[static_cast<int>(move.promotionType().internal())]; }
+    if(board.isCapture(move)) {
+        int victim = chess::Move::ENPASSANT == move.typeOf() ? VALUES[0] : VALUES[static_cast<int>(board.at(move.to()).type().internal())];
+        int attacker = VALUES[static_cast<int>(board.at(move.from()).type().internal())];
+        prior += victim * 10 - attacker + 1; // + 1: even QxP sorts before quiet moves
+    }
+    return static_cast<int16_t>(prior);
+}
+
+// Softmax of the move's eval score over all of the node's legal moves
+float MCTS::Policy(const MCTSNode& node, const MCTSMove& move) const {
+    int best = sortedMoves[node.firstMove].prior;
+    return float(SoftmaxWeight(best - move.prior)) / node.priorSum;
+}
+
+// Q before the first playout: the eval's win probability for the mover, as in SearchValue()
+float MCTS::InitialQ(const MCTSMove& move) const {
+    return static_cast<float>(WinProbability(move.prior));
+}
+
+// exp(-centipawnsBelowBest / PRIOR_TEMPERATURE), from a table of powers of PRIOR_STEP.
+// Built by multiplication, so every machine gets the same bits (unlike libm's exp()).
+double MCTS::SoftmaxWeight(int centipawnsBelowBest) {
+    static const std::vector<double> weights = [] {
+        std::vector<double> table(PRIOR_STEPS);
+        double weight = 1.0;
+        for(double& entry : table) {
+            entry = weight;
+            weight *= PRIOR_STEP;
+        }
+        return table;
+    }();
+    return centipawnsBelowBest < PRIOR_STEPS ? weights[std::max(0, centipawnsBelowBest)] : 0.0;
+}
 
+// 1 / (1 + 10^(-centipawns / SIGMOID_SCALE)) from a table built the same way
+double MCTS::WinProbability(int centipawns) {
+    static const std::vector<double> probabilities = [] {
+        std::vector<double> table(2 * SIGMOID_LIMIT + 1);
+        double odds = 1.0; // 10^(-centipawns / SIGMOID_SCALE) for the losing side's odds
+        for(int cp = 0; cp <= SIGMOID_LIMIT; cp++) {
+            table[SIGMOID_LIMIT + cp] = 1.0 / (1.0 + odds);
+            table[SIGMOID_LIMIT - cp] = odds / (1.0 + odds);
+            odds *= SIGMOID_STEP;
+        }
+        return table;
+    }();
+    return probabilities[SIGMOID_LIMIT + std::clamp(centipawns, -SIGMOID_LIMIT, SIGMOID_LIMIT)];
+}
+
+// Play an edge's move and step onto its child node, linking the edge on first use.
+// The child is NO_NODE when the position is new and the graph is full.
+void MCTS::Descend(uint32_t edge, chess::Board& board) {
+    CHESS_TRACE_CALL("makeMove", board.makeMove(chess::Move(edges.move[edge])));
+    if(NO_NODE == edges.child[edge]) { edges.child[edge] = FindOrAdd(board.hash()); } // new position or a transposition
+    pathEdges.push_back(edge);
+    pathNodes.push_back(edges.child[edge]);
+}
+
+// Rollout: Play a random game to completion and return the game's result.
+// 0.0 for loss, 0.5 for tie, 1.0 for win.
+double MCTS::Simulate(chess::Board board) {
+    CHESS_TRACE_SCOPE("MCTS::Simulate");
     // Set up board state
-    chess::Board board(node->state);
     chess::Color perspective = board.sideToMove(); // for detecting win/loss later
     chess::Movelist moves;
 
@@ -108,8 +331,8 @@ double MCTS::Simulate(MCTSNode* node) {
     chess::GameResult result = board.isGameOver().second;
     while(chess::GameResult::NONE == result) {
         moves.clear();
-        chess::movegen::legalmoves(moves, board);
-        board.makeMove(moves[dist(gen) % moves.size()]);
+        CHESS_TRACE_CALL("movegen", chess::movegen::legalmoves(moves, board));
+        CHESS_TRACE_CALL("makeMove", board.makeMove(moves[rng() % moves.size()])); // raw engine output: identical on every standard library
         result = board.isGameOver().second;
     }
 
@@ -124,60 +347,349 @@ double MCTS::Simulate(MCTSNode* node) {
     }
 }
 
-// Update visits and wins back up the tree.
-void MCTS::Backpropagate(MCTSNode* node, double result) {
-    while(nullptr != node) {
-        ++node->visits;
-        node->wins += result;
+// Leaf value from a shallow search, optionally blended with a short rollout.
+// Same convention as Simulate(): the result is for the player who moved into the leaf.
+double MCTS::EvaluateLeaf(chess::Board board) {
+    CHESS_TRACE_SCOPE("MCTS::EvaluateLeaf");
+    double value = SearchValue(board);
+    if(0.0 >= rolloutMix) { return value; }
+
+    // Short random rollout, scored by the same search where it stops //
+    chess::Color perspective = board.sideToMove();
+    chess::Movelist moves;
+    for(int i = 0; i < SHORT_ROLLOUT_PLIES && chess::GameResult::NONE == board.isGameOver().second; i++) {
+        moves.clear();
+        CHESS_TRACE_CALL("movegen", chess::movegen::legalmoves(moves, board));
+        CHESS_TRACE_CALL("makeMove", board.makeMove(moves[rng() % moves.size()]));
+    }
+    double rollout = SearchValue(board);
+    if(board.sideToMove() != perspective) { rollout = 1.0 - rollout; }
+
+    return (1.0 - rolloutMix) * value + rolloutMix * rollout;
+}
+
+// 1.0 when the side to move is lost, 0.0 when it is winning
+double MCTS::SearchValue(chess::Board& board) {
+    chess::GameResult result = board.isGameOver().second;
+    if(chess::GameResult::DRAW == result) { return 0.5; }
+    if(chess::GameResult::NONE != result) { return 1.0; } // side to move got mated
+
+    int score = leafSearch->Evaluate(board, leafDepth);
+    return 1.0 - WinProbability(score);
+}
+
+// Update visits and wins back along the path that was played, nodes and edges alike.
+// A transposed node collects the playouts of every path through it.
+void MCTS::Backpropagate(double result) {
+    CHESS_TRACE_SCOPE("MCTS::Backpropagate");
+    for(size_t i = pathNodes.size(); 0 < i--;) {
+        if(NO_NODE == pathNodes[i]) { // leaf past a full graph: the edge averages its own playouts
+            uint32_t edge = pathEdges[i - 1];
+            ++edges.visits[edge];
+            edges.q[edge] += static_cast<float>((result - edges.q[edge]) / edges.visits[edge]);
+            result = 1.0 - result;
+            continue;
+        }
+
+        MCTSNode& node = nodes[pathNodes[i]];
+        ++node.visits;
+        node.wins += result;
+        if(0 < i) {
+            uint32_t edge = pathEdges[i - 1];
+            ++edges.visits[edge];
+            edges.q[edge] = static_cast<float>(node.wins / node.visits); // includes every other path into the node
+        }
         result = 1.0 - result; // flip result; your win is your parent's loss!
-        node = node->parent;
     }
 }
 
-// ---------------------------------------- MCTS (helper) ---------------------------------------- //
+// Best edge of an expanded node: PUCT with eval priors, otherwise UCB1 where unvisited
+// edges come first, in prior order.
+// C == sqrt(2) generally gives a good balance between exploitation and exploration
+// C == 0 yields pure exploitation, C > sqrt(2) yields more exploration
+uint32_t MCTS::SelectEdge(uint32_t node) const {
+    const MCTSNode& parent = nodes[node];
+    uint32_t first = parent.firstEdge;
+    alignas(32) float scores[MAX_MOVES];
+    if(evalPriors) {
+        float sqrtParentVisits = std::sqrt(float(parent.visits)); // once per node, not per edge
+        PUCTScores(&edges.q[first], &edges.visits[first], &edges.prior[first], parent.numEdges,
+            sqrtParentVisits, float(exploration), scores);
+    }
+    else {
+        float logParentVisits = LogVisits(std::max(1u, parent.visits));
+        UCBScores(&edges.q[first], &edges.visits[first], parent.numEdges, logParentVisits, float(exploration), scores);
+    }
+
+    int best = 0;
+    for(int i = 1; i < parent.numEdges; i++) {
+        if(scores[i] > scores[best]) { best = i; }
+    }
+    return parent.firstEdge + best;
+}
+
+// ---------------------------------------- MCTS (graph) ---------------------------------------- //
+
+uint32_t MCTS::Find(uint64_t key) const {
+    if(table.empty()) { return NO_NODE; }
+    size_t mask = table.size() - 1;
+    for(size_t slot = key & mask; NO_NODE != table[slot]; slot = (slot + 1) & mask) {
+        if(key == nodes[table[slot]].key) { return table[slot]; }
+    }
+    return NO_NODE;
+}
 
-// Select the best child as the move to play.
-MCTSNode* MCTS::BestChild(const MCTSNode* root) {
-    return *std::max_element(
-        root->children.begin(), root->children.end(),
-        [](MCTSNode* a, MCTSNode* b) {
-            return a->visits < b->visits;
+// NO_NODE when the key is new and the graph is full
+uint32_t MCTS::FindOrAdd(uint64_t key) {
+    uint32_t found = Find(key);
+    if(NO_NODE != found || nodes.size() == nodes.capacity()) { return found; }
+
+    uint32_t index = static_cast<uint32_t>(nodes.size());
+    MCTSNode node;
+    node.key = key;
+    nodes.push_back(node);
+
+    size_t mask = table.size() - 1;
+    size_t slot = key & mask;
+    while(NO_NODE != table[slot]) { slot = (slot + 1) & mask; }
+    table[slot] = index;
+    return index;
+}
+
+void MCTS::Rehash() {
+    table.assign(table.capacity(), NO_NODE);
+    size_t mask = table.size() - 1;
+    for(uint32_t i = 0; i < nodes.size(); i++) {
+        size_t slot = nodes[i].key & mask;
+        while(NO_NODE != table[slot]) { slot = (slot + 1) & mask; }
+        table[slot] = i;
+    }
+}
+
+// Keep only what is reachable from the new root, renumbered breadth-first
+void MCTS::Compact(uint32_t newRoot) {
+    std::vector<uint32_t> remap(nodes.size(), NO_NODE);
+    std::vector<uint32_t> order = { newRoot };
+    remap[newRoot] = 0;
+    for(size_t i = 0; i < order.size(); i++) {
+        const MCTSNode& node = nodes[order[i]];
+        for(uint32_t e = node.firstEdge; e < node.firstEdge + node.numEdges; e++) {
+            uint32_t child = edges.child[e];
+            if(NO_NODE != child && NO_NODE == remap[child]) {
+                remap[child] = static_cast<uint32_t>(order.size());
+                order.push_back(child);
+            }
         }
-    );
+    }
+
+    // The kept part is gathered on the side, then copied back to the front of the graph's arrays //
+    struct KeptEdge {
+        uint32_t child;
+        uint16_t move;
+        float prior;
+        float q;
+        uint32_t visits;
+    };
+    std::vector<MCTSNode> keptNodes;
+    std::vector<MCTSMove> keptMoves;
+    std::vector<KeptEdge> keptEdges;
+    keptNodes.reserve(order.size());
+    for(uint32_t index : order) {
+        MCTSNode node = nodes[index];
+        uint32_t firstMove = static_cast<uint32_t>(keptMoves.size());
+        keptMoves.insert(keptMoves.end(), sortedMoves.begin() + node.firstMove, sortedMoves.begin() + node.firstMove + node.numMoves);
+        uint32_t firstEdge = static_cast<uint32_t>(keptEdges.size());
+        for(uint32_t e = node.firstEdge; e < node.firstEdge + node.numEdges; e++) {
+            uint32_t child = edges.child[e];
+            keptEdges.push_back({ NO_NODE != child ? remap[child] : NO_NODE, edges.move[e], edges.prior[e], edges.q[e], edges.visits[e] });
+        }
+        node.firstMove = firstMove;
+        node.firstEdge = firstEdge;
+        node.edgeCapacity = node.numEdges; // the holes left by widening go away here
+        keptNodes.push_back(node);
+    }
+
+    nodes.assign(keptNodes.data(), keptNodes.data() + keptNodes.size());
+    sortedMoves.assign(keptMoves.data(), keptMoves.data() + keptMoves.size());
+    edges.resize(keptEdges.size());
+    for(size_t e = 0; e < keptEdges.size(); e++) {
+        const KeptEdge& kept = keptEdges[e];
+        edges.Set(e, kept.child, kept.move, kept.prior, kept.q);
+        edges.visits[e] = kept.visits;
+    }
+    root = 0;
+    Rehash();
+}
+
+// Room to expand one more node: all of its moves and edges, and the child it descends to
+bool MCTS::GraphHasRoom() const {
+    return nodes.size() < nodes.capacity() && sortedMoves.size() + MAX_MOVES <= sortedMoves.capacity()
+        && edges.size() + MAX_MOVES <= edges.capacity();
+}
+
+// One budget block carved into the graph's arrays
+void MCTS::Prepare() {
+    if(0 < graphBlock.Size()) { return; }
+    graphBlock = MemoryBudget::Global().Allocate(MemoryComponent::MCTS, MemoryBudget::Global().Share(MemoryComponent::MCTS));
+
+    // The block is a power of two of at least 64 KB, so the table is too //
+    size_t nodeCapacity = graphBlock.Size() / BYTES_PER_NODE;
+    size_t moveCapacity = nodeCapacity * MOVES_PER_NODE;
+    size_t fixedBytes = nodeCapacity * (sizeof(MCTSNode) + 2 * sizeof(uint32_t)) + moveCapacity * sizeof(MCTSMove);
+    size_t edgeCapacity = (graphBlock.Size() - fixedBytes - 8 * 64) / MCTSEdges::BYTES_PER_EDGE; // 64: each array's alignment
+    static_assert(sizeof(MCTSNode) + 2 * sizeof(uint32_t) + MOVES_PER_NODE * sizeof(MCTSMove) + 2 * MCTSEdges::BYTES_PER_EDGE < BYTES_PER_NODE);
+
+    char* storage = graphBlock.As<char>();
+    storage = table.Attach(storage, 2 * nodeCapacity);
+    storage = nodes.Attach(storage, nodeCapacity);
+    storage = sortedMoves.Attach(storage, moveCapacity);
+    edges.Attach(storage, edgeCapacity);
+    table.assign(table.capacity(), NO_NODE);
+}
+
+// ---------------------------------------- MCTS (helper) ---------------------------------------- //
+
+void MCTS::SetLeafSearch(bool enabled, int depth, double rolloutMix) {
+    if(!enabled) { leafSearch.reset(); }
+    else if(nullptr == leafSearch) {
+        // A small table of its own, reserved now: the first timed move doesn't allocate it,
+        // and it isn't a full engine's TT share on top of the split set by SetConcurrency()
+        leafSearch = std::make_unique<NegaMax>(LEAF_TT_BYTES);
+        leafSearch->Prepare();
+    }
+    leafDepth = std::max(0, depth);
+    this->rolloutMix = std::clamp(rolloutMix, 0.0, 1.0);
+}
+
+// Select the best move of a node; NO_NODE if it has none.
+uint32_t MCTS::BestEdge(uint32_t node) const {
+    uint32_t best = NO_NODE;
+    for(uint32_t e = nodes[node].firstEdge; e < nodes[node].firstEdge + nodes[node].numEdges; e++) {
+        if(NO_NODE == best || edges.visits[e] > edges.visits[best]) { best = e; }
+    }
+    return best;
 
     // This uses the "most visits" strategy.
     // Other strategies include "highest win rate" (max[wins/visits])
     // and "robust child" (fusion of the other two strategies).
 }
 
-// Recursively counts the number of children
-int MCTS::NumNodes(const MCTSNode* node) {
-    int numRecursiveChildren = 0;
-    for(MCTSNode* child : node->children) { numRecursiveChildren += NumNodes(child); }
-    return ++numRecursiveChildren;
+// Top root moves by visits. An edge's q is the child's value for the player
+// who chose it, so it is Q for the side to move at the root.
+void MCTS::CollectLines(int multiPV) {
+    lines.clear();
+    if(0 == nodes[root].numEdges) { return; }
+
+    std::vector<uint32_t> top;
+    for(uint32_t e = nodes[root].firstEdge; e < nodes[root].firstEdge + nodes[root].numEdges; e++) { top.push_back(e); }
+    int numLines = std::clamp<int>(multiPV, 1, top.size());
+    std::partial_sort(top.begin(), top.begin() + numLines, top.end(),
+        [&](uint32_t a, uint32_t b) { return edges.visits[a] > edges.visits[b]; });
+
+    const int MAX_PV = 64; // the graph can cycle through repetitions
+    for(int i = 0; i < numLines; i++) {
+        uint32_t edge = top[i];
+        SearchLine line;
+        line.move = chess::uci::moveToUci(chess::Move(edges.move[edge]));
+        line.visits = edges.visits[edge];
+        line.q = 0 < edges.visits[edge] ? edges.q[edge] : 0.5;
+
+        // logistic win probability -> centipawns
+        double q = std::clamp(line.q, 0.001, 0.999);
+        line.score = int(std::round(400.0 * std::log10(q / (1.0 - q))));
+
+        // follow the most visited replies for the PV
+        line.pv = line.move;
+        line.depth = 1;
+        uint32_t node = edges.child[edge];
+        while(NO_NODE != node && line.depth < MAX_PV) {
+            uint32_t reply = BestEdge(node);
+            if(NO_NODE == reply || 0 >= edges.visits[reply]) { break; }
+            line.pv += ' ' + chess::uci::moveToUci(chess::Move(edges.move[reply]));
+            ++line.depth;
+            node = edges.child[reply];
+        }
+        lines.push_back(line);
+    }
 }
 
-// Attempt to reuse the MCTS tree from last move.
-// If that isn't possible, generate a new tree.
-void MCTS::ReuseTree(const std::string& fen) {
-    // no tree exists, create new tree
-    if(nullptr == root) {
-        root = new MCTSNode(fen);
-        return;
+// Playouts, NPS and the most visited root moves' share of visits.
+void MCTS::Publish(uint64_t playouts, int64_t elapsedMS, bool final) {
+    TelemetrySample sample;
+    sample.engine = TelemetrySample::Engine::MCTS;
+    sample.final = final;
+    sample.timeMS = elapsedMS;
+    sample.nodes = playouts;
+    sample.nps = 0 < elapsedMS ? playouts * 1000 / elapsedMS : 0;
+
+    std::vector<uint32_t> top;
+    for(uint32_t e = nodes[root].firstEdge; e < nodes[root].firstEdge + nodes[root].numEdges; e++) { top.push_back(e); }
+    int numTop = std::min<int>(TelemetrySample::TOP_CHILDREN, top.size());
+    std::partial_sort(top.begin(), top.begin() + numTop, top.end(),
+        [&](uint32_t a, uint32_t b) { return edges.visits[a] > edges.visits[b]; });
+
+    sample.numTopChildren = numTop;
+    for(int i = 0; i < numTop; i++) {
+        std::snprintf(sample.topMoves[i], sizeof(sample.topMoves[i]), "%s", chess::uci::moveToUci(chess::Move(edges.move[top[i]])).c_str());
+        sample.topShares[i] = 0 < nodes[root].visits ? float(edges.visits[top[i]]) / nodes[root].visits : 0.0f;
     }
+    telemetry->Push(sample);
+}
 
-    // check if one of the child nodes can become reused tree
-    for(MCTSNode* child : root->children) {
-        if(fen == child->state) {
-            child->parent = nullptr;
-            root->DeleteOtherChildren(child);
-            root = child;
-            return;
+// Visited nodes breadth-first, each once however many paths reach it, so every
+// record's parent (the first one found) is already in the file. A node's visits and
+// wins are those of the edge it was reached by: the shared node's own count includes
+// playouts from other parents, and would let a child outweigh its parent.
+void MCTS::RecordTree() {
+    recorder->BeginMove(nodes[root].key);
+    std::vector<bool> queued(nodes.size(), false);
+    std::vector<uint8_t> plies(nodes.size(), 0);
+    std::vector<uint32_t> parents(nodes.size(), 0);
+    std::deque<std::pair<uint32_t, uint32_t>> queue = { { root, NO_NODE } }; // node, edge into it (NO_NODE at the root)
+    queued[root] = true;
+    uint32_t index = 0;
+    while(!queue.empty()) {
+        auto [node, edge] = queue.front();
+        queue.pop_front();
+
+        TreeRecorder::MCTSRecord record = {};
+        record.type = TreeRecorder::MCTS_NODE;
+        record.ply = plies[node];
+        record.children = nodes[node].numMoves;
+        record.move = NO_NODE != edge ? edges.move[edge] : chess::Move::NO_MOVE;
+        record.hash = nodes[node].key;
+        record.parent = parents[node];
+        record.visits = NO_NODE != edge ? edges.visits[edge] : nodes[node].visits;
+        record.wins = NO_NODE != edge ? double(edges.q[edge]) * edges.visits[edge] : nodes[node].wins;
+        recorder->Write(record);
+
+        for(uint32_t e = nodes[node].firstEdge; e < nodes[node].firstEdge + nodes[node].numEdges; e++) {
+            uint32_t child = edges.child[e];
+            if(NO_NODE == child || 0 >= edges.visits[e] || queued[child]) { continue; }
+            queued[child] = true;
+            plies[child] = static_cast<uint8_t>(std::min(plies[node] + 1, 255));
+            parents[child] = index;
+            queue.push_back({ child, e });
         }
+        ++index;
+    }
+    recorder->Flush();
+}
+
+// Attempt to reuse the graph from last move: whatever was searched below the
+// new position (through any move order) is kept, everything else is dropped.
+void MCTS::ReuseTree(const std::string& fen) {
+    rootBoard.setFen(fen);
+    uint32_t found = Find(rootBoard.hash());
+    if(NO_NODE != found) {
+        Compact(found);
+        return;
     }
 
-    // opponent's move didn't match any children; create new tree
-    delete root;
-    root = new MCTSNode(fen);
-    return;
+    // position not in the graph; start a new one
+    nodes.clear();
+    sortedMoves.clear();
+    edges.clear();
+    Rehash();
+    root = FindOrAdd(rootBoard.hash());
 }
@@ -1,55 +1,270 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <random>
 #include <vector>
 #include "chess.hpp"
+#include "memory-budget.h"
+#include "negamax.h"
+#include "search-limits.h"
+#include "search-line.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "tree-recorder.h"
 
 // Built from slides code: https://gameguild.gg/p/ai4games2/week-05
 
-class MCTSNode {
+// The search is a graph rather than a tree: nodes are keyed by Zobrist hash,
+// so every move order reaching a position shares one node and its statistics.
+// Visit counts that drive exploration live on the edges (how often this path
+// took the move), while the value of a move is read from the shared child node.
+//
+// Expansion is lazy (progressive widening): a node keeps its legal moves as a
+// compact list sorted by a cheap prior and only turns the first
+// WIDENING_BASE + sqrt(visits) of them into edges.
+//
+// With eval priors (the default) one Eval::EvaluateBatch() call scores every
+// child of a node on expansion. The scores order the moves, give each edge a
+// softmax policy for PUCT selection and an initial Q before its first playout.
+// Without them moves are ordered by MVV-LVA and selected by UCB1.
+
+// Fixed-capacity array over part of the graph's MemoryBlock. It never reallocates,
+// so the graph can't outgrow its budget share, and its pages are faulted in up front.
+template <typename T>
+class GraphArray {
 public:
-    MCTSNode* parent;
-    std::vector<MCTSNode*> children;
-    double wins; // draws count as 0.5 wins
-    int visits;
-    
-    std::string state; // board state in FEN
-    std::string move; // move made to get here in UCI
-
-    MCTSNode(std::string fen, std::string uci = "", MCTSNode* parentNode = nullptr)
-        : state(fen), move(uci), parent(parentNode), wins(0.0), visits(0) {}
-    ~MCTSNode() {
-        while(0 < children.size()) {
-            delete children.back();
-            children.pop_back();
-        }
-    }
-
-    bool isLeaf() { return children.empty(); }
-
-    double UCB(double C = std::sqrt(2.0));
-    void DeleteOtherChildren(const MCTSNode* save);
+    // Take `capacity` items at `storage` (rounded up to a cache line); returns where the next array can start
+    char* Attach(char* storage, size_t capacity) {
+        storage = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(storage) + 63) & ~uintptr_t(63));
+        items = reinterpret_cast<T*>(storage);
+        count = 0;
+        limit = capacity;
+        return storage + capacity * sizeof(T);
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return limit; }
+    bool empty() const { return 0 == count; }
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    // Callers check capacity() first
+    void push_back(const T& item) { items[count++] = item; }
+    void resize(size_t n) {
+        std::fill(items + std::min(count, n), items + n, T());
+        count = n;
+    }
+    void assign(size_t n, const T& value) {
+        std::fill(items, items + n, value);
+        count = n;
+    }
+    void assign(const T* first, const T* last) {
+        std::copy(first, last, items);
+        count = size_t(last - first);
+    }
+    void clear() { count = 0; }
+
+private:
+    T* items = nullptr;
+    size_t count = 0;
+    size_t limit = 0;
+};
+
+// Statistics of a position, shared by every path that reaches it
+struct MCTSNode {
+    uint64_t key;           // Zobrist hash
+    double wins = 0.0;      // for the player who moved into this position; draws count as 0.5 wins
+    uint32_t visits = 0;
+    uint32_t firstMove = 0; // legal moves, best prior first: sortedMoves[firstMove, firstMove + numMoves)
+    uint32_t firstEdge = 0; // edges for the first numEdges of them: edges[firstEdge, firstEdge + numEdges)
+    uint16_t numMoves = 0;
+    uint16_t numEdges = 0;
+    uint16_t edgeCapacity = 0; // slots reserved at firstEdge; widening past it moves the edges to the end
+    bool expanded = false;
+    float priorSum = 0.0f; // softmax denominator of the moves' eval priors
+};
+
+// Moves out of nodes with the statistics of the playouts that took them, as
+// structure-of-arrays: a node's edges are contiguous in every array, so
+// Select() scores all of them in one SIMD pass over q and visits.
+struct MCTSEdges {
+    GraphArray<float> q;         // value for the player making the move: the shared child node's, as of the last playout through this edge (or the eval's guess)
+    GraphArray<uint32_t> visits; // playouts through this edge
+    GraphArray<uint32_t> child;  // node index, NO_NODE until the move is first played (or while the graph is full)
+    GraphArray<float> prior;     // PUCT policy with eval priors, otherwise the move-ordering score the moves were sorted by
+    GraphArray<uint16_t> move;   // chess::Move encoding
+
+    static constexpr size_t BYTES_PER_EDGE = 2 * sizeof(float) + 2 * sizeof(uint32_t) + sizeof(uint16_t);
+
+    size_t size() const { return move.size(); }
+    size_t capacity() const { return move.capacity(); }
+
+    char* Attach(char* storage, size_t capacity) {
+        storage = q.Attach(storage, capacity);
+        storage = visits.Attach(storage, capacity);
+        storage = child.Attach(storage, capacity);
+        storage = prior.Attach(storage, capacity);
+        return move.Attach(storage, capacity);
+    }
+
+    void resize(size_t count) {
+        q.resize(count);
+        visits.resize(count);
+        child.resize(count);
+        prior.resize(count);
+        move.resize(count);
+    }
+    void clear() { resize(0); }
+
+    // Copy edge `from` to the end
+    void PushCopy(size_t from) {
+        q.push_back(q[from]);
+        visits.push_back(visits[from]);
+        child.push_back(child[from]);
+        prior.push_back(prior[from]);
+        move.push_back(move[from]);
+    }
+    void Set(size_t edge, uint32_t childNode, uint16_t moveBits, float moveOrderingPrior, float initialQ) {
+        q[edge] = initialQ;
+        visits[edge] = 0;
+        child[edge] = childNode;
+        prior[edge] = moveOrderingPrior;
+        move[edge] = moveBits;
+    }
+};
+
+// A legal move that may not have an edge yet
+struct MCTSMove {
+    uint16_t move;
+    int16_t prior; // centipawns for the mover with eval priors, MVV-LVA otherwise
 };
 
 class MCTS {
 public:
-    ~MCTS() { if(nullptr != root) { delete root; } }
+    // limits.nodes counts playouts and limits.depth caps the tree depth; mate is ignored
+    std::string Move(const std::string& fen, const SearchLimits& limits);
+
+    // Most visited root moves of the last search with their Q-values (limits.multiPV of them)
+    const std::vector<SearchLine>& Lines() const { return lines; }
+    uint64_t Playouts() const { return lastPlayouts; }
+
+    // UCB1 / PUCT exploration constant (see SelectEdge())
+    void SetExploration(double C) { exploration = C; }
+
+    // Score new nodes' children with Eval::EvaluateBatch() for PUCT priors and initial Q-values
+    void SetEvalPriors(bool enabled) { evalPriors = enabled; }
+
+    // Evaluate leaves with a shallow NegaMax search (depth 0 == quiescence only) mapped
+    // through a sigmoid instead of random playouts to the end of the game.
+    // rolloutMix (0..1) blends in a short random rollout scored the same way.
+    void SetLeafSearch(bool enabled, int depth = 0, double rolloutMix = 0.0);
+
+    // Publish playouts/NPS/top-child visit shares while searching (nullptr disables)
+    void SetTelemetry(TelemetryRing* ring) { telemetry = ring; }
+
+    // Write the searched graph to a recorder after every move (nullptr disables)
+    void SetRecorder(TreeRecorder* treeRecorder) { recorder = treeRecorder; }
 
-    std::string Move(const std::string& fen, int64_t timeLimitMS = 9990);
+    // Allocate the graph from the memory budget now instead of on the first search.
+    // Call it after the budget is configured; a no-op once the graph exists.
+    void Prepare();
 
 private:
-    MCTSNode* root = nullptr;
+    static constexpr uint32_t NO_NODE = std::numeric_limits<uint32_t>::max();
+
+    // Graph: nodes and their edges in flat arrays, found by key through an open-addressing table //
+    GraphArray<MCTSNode> nodes;
+    GraphArray<MCTSMove> sortedMoves; // legal moves of every expanded node
+    MCTSEdges edges; // may hold abandoned slots after widening until the next Compact()
+    GraphArray<uint32_t> table; // node indices, NO_NODE == empty; twice the node capacity, so at most half full
+    uint32_t root = NO_NODE;
+    chess::Board rootBoard;
+    uint32_t Find(uint64_t key) const;
+    uint32_t FindOrAdd(uint64_t key);
+    void Rehash();
+
+    // Current playout: nodes from the root down and the edges between them //
+    std::vector<uint32_t> pathNodes;
+    std::vector<uint32_t> pathEdges;
+
+    std::vector<SearchLine> lines;
+    uint64_t lastPlayouts = 0;
+
+    // Memory: one block of the budget's share holds the whole graph, kept between moves.
+    // Per node of capacity it has room for two table slots and MOVES_PER_NODE moves;
+    // edges take the rest. Once full, the graph stops growing until the next Compact(). //
+    static constexpr size_t BYTES_PER_NODE = 256;
+    static constexpr size_t MOVES_PER_NODE = 20;
+    MemoryBlock graphBlock;
+    bool GraphHasRoom() const;
+    double exploration = std::sqrt(2.0);
+
+    // Progressive widening: edges = WIDENING_BASE + WIDENING_FACTOR * sqrt(visits) //
+    const double WIDENING_BASE = 2.0;
+    const double WIDENING_FACTOR = 1.0;
+
+    // Eval priors: policy = softmax(centipawns / PRIOR_TEMPERATURE) //
+    bool evalPriors = true;
+    Eval priorEval;
+    static constexpr double PRIOR_TEMPERATURE = 100.0;
+    static constexpr double PRIOR_STEP = 0.99004983374916805; // exp(-1 / PRIOR_TEMPERATURE)
+    static constexpr int PRIOR_STEPS = 2048; // moves further below the best get no policy
+    float Policy(const MCTSNode& node, const MCTSMove& move) const;
+    float InitialQ(const MCTSMove& move) const;
+    static double SoftmaxWeight(int centipawnsBelowBest);
+
+    // mt19937's output is fully specified by the standard, and the search only uses
+    // correctly rounded arithmetic (+ - * / sqrt, tables instead of libm's exp/pow/log),
+    // so a fixed seed gives bit-identical playouts on every machine for node-limited searches
+    std::mt19937 rng{std::random_device{}()};
+    const uint32_t NODE_LIMIT_SEED = 20240917;
+
+    // Leaf evaluation //
+    std::unique_ptr<NegaMax> leafSearch; // nullptr == random playouts
+    static constexpr size_t LEAF_TT_BYTES = size_t(1) << 20; // shallow searches revisit few positions
+    int leafDepth = 0;
+    double rolloutMix = 0.0;
+    const int SHORT_ROLLOUT_PLIES = 8;
+    static constexpr double SIGMOID_SCALE = 400.0; // centipawns per factor 10 in win odds
+    static constexpr double SIGMOID_STEP = 0.99426007395295666; // 10^(-1 / SIGMOID_SCALE)
+    static constexpr int SIGMOID_LIMIT = 4000; // centipawns; odds of 10^10 are a certain result
+    static double WinProbability(int centipawns);
+    double EvaluateLeaf(chess::Board board);
+    double SearchValue(chess::Board& board);
+
+    // Telemetry //
+    const int TELEMETRY_INTERVAL_MS = 50;
+    TelemetryRing* telemetry = nullptr;
+    void Publish(uint64_t playouts, int64_t elapsedMS, bool final);
+
+    // Tree recording //
+    TreeRecorder* recorder = nullptr;
+    void RecordTree();
 
     // MCTS steps //
-    MCTSNode* Select(MCTSNode* node);
-    MCTSNode* Expand(MCTSNode* node);
-    double Simulate(MCTSNode* node);
-    void Backpropagate(MCTSNode* node, double result);
+    bool Select(chess::Board& board);
+    void Expand(uint32_t node, const chess::Board& board);
+    void Widen(uint32_t node, uint16_t numEdges);
+    uint16_t WidenedEdges(const MCTSNode& node) const;
+    static int16_t Prior(const chess::Board& board, chess::Move move);
+    void Descend(uint32_t edge, chess::Board& board);
+    double Simulate(chess::Board board);
+    void Backpropagate(double result);
+    uint32_t SelectEdge(uint32_t node) const;
 
     // Helpers //
-    MCTSNode* BestChild(const MCTSNode* root);
+    uint32_t BestEdge(uint32_t node) const;
+    void CollectLines(int multiPV);
     void ReuseTree(const std::string& fen);
-    int NumNodes(const MCTSNode* node);
+    void Compact(uint32_t newRoot);
 };
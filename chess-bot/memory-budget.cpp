@@ -0,0 +1,201 @@
+#include "memory-budget.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ---------------------------------------- MemoryBlock ---------------------------------------- //
+
+MemoryBlock& MemoryBlock::operator=(MemoryBlock&& other) noexcept {
+    if(this != &other) {
+        Release();
+        data = other.data;
+        size = other.size;
+        mappedSize = other.mappedSize;
+        hugePages = other.hugePages;
+        component = other.component;
+        other.data = nullptr;
+        other.size = 0;
+        other.mappedSize = 0;
+    }
+    return *this;
+}
+
+void MemoryBlock::Release() {
+    if(nullptr == data) { return; }
+    MemoryBudget::Global().Free(*this);
+    data = nullptr;
+    size = 0;
+    mappedSize = 0;
+}
+
+// ---------------------------------------- MemoryBudget ---------------------------------------- //
+
+MemoryBudget& MemoryBudget::Global() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget() {
+    if(const char* mb = std::getenv("CHESS_MEMORY_MB")) {
+        long long value = std::atoll(mb);
+        if(0 < value) { total = size_t(value) << 20; }
+    }
+}
+
+void MemoryBudget::Configure(size_t totalBytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    total = totalBytes;
+}
+
+void MemoryBudget::SetConcurrency(int engines) {
+    std::lock_guard<std::mutex> lock(mutex);
+    concurrency = std::max(1, engines);
+}
+
+size_t MemoryBudget::Share(MemoryComponent component) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t index = size_t(component);
+    size_t share = total / 100 * SHARE_PERCENT[index];
+    return PER_ENGINE[index] ? share / concurrency : share;
+}
+
+MemoryBlock MemoryBudget::Allocate(MemoryComponent component, size_t bytes, size_t minBytes) {
+    MemoryBlock block;
+    block.component = component;
+
+    // Fit the request into what is left of the budget //
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t remaining = total > UsedLocked() ? total - UsedLocked() : 0;
+        size_t granted = std::max(std::min(bytes, remaining), minBytes);
+        block.size = std::bit_floor(granted);
+    }
+
+#if defined(__linux__)
+    // Over-map by one huge page so the block can start on a 2 MB boundary //
+    if(block.size >= HUGE_PAGE) {
+        size_t mapped = block.size + HUGE_PAGE;
+        void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(MAP_FAILED != raw) {
+            uintptr_t start = (uintptr_t(raw) + HUGE_PAGE - 1) & ~uintptr_t(HUGE_PAGE - 1);
+            size_t head = start - uintptr_t(raw);
+            size_t tail = mapped - head - block.size;
+            if(0 < head) { munmap(raw, head); }
+            if(0 < tail) { munmap(reinterpret_cast<void*>(start + block.size), tail); }
+
+            block.data = reinterpret_cast<void*>(start);
+            block.mappedSize = block.size;
+#if defined(MADV_HUGEPAGE)
+            block.hugePages = 0 == madvise(block.data, block.size, MADV_HUGEPAGE);
+#endif
+        }
+    }
+#endif
+    if(nullptr == block.data) { block.data = ::operator new(block.size, std::align_val_t(64)); }
+
+    // Pre-fault now rather than during the first search //
+    std::memset(block.data, 0, block.size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    used[size_t(component)] += block.size;
+    blocks[size_t(component)] += 1;
+    if(block.hugePages) { hugePageBytes[size_t(component)] += block.size; }
+    return block;
+}
+
+MemoryBlock MemoryBudget::MapFile(MemoryComponent component, const std::string& path, size_t bytes, bool writable) {
+    MemoryBlock block;
+    block.component = component;
+
+#if defined(__unix__) || defined(__APPLE__)
+    int fd = open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if(0 > fd) { return block; }
+
+    struct stat info;
+    if(0 != fstat(fd, &info)) {
+        close(fd);
+        return block;
+    }
+    if(!writable) { bytes = size_t(info.st_size); }
+    else if(size_t(info.st_size) != bytes && 0 != ftruncate(fd, off_t(bytes))) {
+        close(fd);
+        return block;
+    }
+    if(0 == bytes) {
+        close(fd);
+        return block;
+    }
+
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE; // pre-fault: read the file in now, not during the search
+#endif
+    void* data = mmap(nullptr, bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ, flags, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if(MAP_FAILED == data) { return block; }
+
+    block.data = data;
+    block.size = bytes;
+    block.mappedSize = bytes;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    used[size_t(component)] += block.size;
+    blocks[size_t(component)] += 1;
+#endif
+    return block;
+}
+
+void MemoryBudget::Free(MemoryBlock& block) {
+#if defined(__unix__) || defined(__APPLE__)
+    if(0 < block.mappedSize) { munmap(block.data, block.mappedSize); }
+    else { ::operator delete(block.data, std::align_val_t(64)); }
+#else
+    ::operator delete(block.data, std::align_val_t(64));
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex);
+    used[size_t(block.component)] -= block.size;
+    blocks[size_t(block.component)] -= 1;
+    if(block.hugePages) { hugePageBytes[size_t(block.component)] -= block.size; }
+}
+
+std::vector<MemoryUsage> MemoryBudget::Usage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<MemoryUsage> usage;
+    for(size_t i = 0; i < size_t(MemoryComponent::COUNT); i++) {
+        MemoryUsage entry;
+        entry.component = Name(MemoryComponent(i));
+        entry.bytes = used[i];
+        entry.blocks = blocks[i];
+        entry.hugePageBytes = hugePageBytes[i];
+        usage.push_back(entry);
+    }
+    return usage;
+}
+
+const char* MemoryBudget::Name(MemoryComponent component) {
+    switch(component) {
+        case MemoryComponent::TT: return "tt";
+        case MemoryComponent::MCTS: return "mcts";
+        case MemoryComponent::EVAL_CACHE: return "eval-cache";
+        case MemoryComponent::PAWN_TABLE: return "pawn-table";
+        case MemoryComponent::MAPPINGS: return "mappings";
+        case MemoryComponent::MATE_SOLVER: return "mate-solver";
+        default: return "?";
+    }
+}
+
+size_t MemoryBudget::UsedLocked() const {
+    size_t sum = 0;
+    for(size_t value : used) { sum += value; }
+    return sum;
+}
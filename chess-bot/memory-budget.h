@@ -0,0 +1,104 @@
+// One process-wide memory budget that every large table draws from:
+// NegaMax transposition tables, MCTS trees, the eval cache, pawn tables,
+// mate solver tables and file mappings (opening books, tablebases). Each component gets a fixed share
+// of the total; per-engine components split their share between the engines
+// that run at the same time.
+//
+// Blocks are allocated on 2 MB transparent huge pages where the OS supports it
+// and are pre-faulted (zeroed) on allocation, so no page faults land inside a
+// timed search. File mappings are pre-faulted too, but keep their contents.
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class MemoryComponent : uint8_t { TT, MCTS, EVAL_CACHE, PAWN_TABLE, MAPPINGS, MATE_SOLVER, COUNT };
+
+// Move-only owner of a zeroed, 64-byte aligned allocation handed out by MemoryBudget
+class MemoryBlock {
+public:
+    MemoryBlock() = default;
+    MemoryBlock(MemoryBlock&& other) noexcept { *this = std::move(other); }
+    MemoryBlock& operator=(MemoryBlock&& other) noexcept;
+    MemoryBlock(const MemoryBlock&) = delete;
+    MemoryBlock& operator=(const MemoryBlock&) = delete;
+    ~MemoryBlock() { Release(); }
+
+    template <typename T>
+    T* As() const { return static_cast<T*>(data); }
+    size_t Size() const { return size; }
+    bool HugePages() const { return hugePages; }
+
+private:
+    friend class MemoryBudget;
+
+    void* data = nullptr;
+    size_t size = 0;
+    size_t mappedSize = 0; // 0 == heap allocation, otherwise the length to munmap
+    bool hugePages = false;
+    MemoryComponent component = MemoryComponent::COUNT;
+
+    void Release();
+};
+
+struct MemoryUsage {
+    std::string component;
+    size_t bytes = 0;
+    size_t blocks = 0;
+    size_t hugePageBytes = 0;
+};
+
+class MemoryBudget {
+    friend class MemoryBlock;
+
+public:
+    // Total from the CHESS_MEMORY_MB environment variable (default 1024 MB)
+    static MemoryBudget& Global();
+
+    // Affects allocations made after the call
+    void Configure(size_t totalBytes);
+    void SetConcurrency(int engines);
+
+    size_t Total() const { return total; }
+
+    // Bytes one instance of the component should ask for
+    size_t Share(MemoryComponent component) const;
+
+    // A block of at most `bytes`: the largest power of two that still fits in
+    // the remaining budget, but never below minBytes so an engine always works.
+    MemoryBlock Allocate(MemoryComponent component, size_t bytes, size_t minBytes = 64 * 1024);
+
+    // Map a file shared with other processes. writable: create it or resize it to
+    // `bytes`. Read-only: map the whole file (bytes is ignored). An empty block
+    // means the file couldn't be mapped (or mapping isn't supported here).
+    MemoryBlock MapFile(MemoryComponent component, const std::string& path, size_t bytes, bool writable);
+
+    std::vector<MemoryUsage> Usage() const;
+
+    static const char* Name(MemoryComponent component);
+
+private:
+    static constexpr size_t DEFAULT_MB = 1024;
+    static constexpr size_t HUGE_PAGE = size_t(2) << 20;
+
+    // Percent of the total per component (the rest is headroom)
+    static constexpr std::array<int, size_t(MemoryComponent::COUNT)> SHARE_PERCENT = { 43, 30, 8, 2, 10, 2 };
+    // Components every engine owns a copy of (their share is split by concurrency)
+    static constexpr std::array<bool, size_t(MemoryComponent::COUNT)> PER_ENGINE = { true, true, false, true, false, true };
+
+    MemoryBudget();
+
+    mutable std::mutex mutex;
+    size_t total = DEFAULT_MB << 20;
+    int concurrency = 1;
+    std::array<size_t, size_t(MemoryComponent::COUNT)> used = {};
+    std::array<size_t, size_t(MemoryComponent::COUNT)> blocks = {};
+    std::array<size_t, size_t(MemoryComponent::COUNT)> hugePageBytes = {};
+
+    void Free(MemoryBlock& block);
+    size_t UsedLocked() const;
+};
@@ -1,18 +1,40 @@
 #include "negamax.h"
 
-std::string NegaMax::Move(const std::string& fen, int timeLimitMS) {
+std::string NegaMax::Move(const std::string& fen, const SearchLimits& limits) {
+    Prepare(); // a first allocation is not charged to the clock
+
     // Reset iterative deepening stuff //
     startTime = std::chrono::steady_clock::now();
     nodeCount = 0;
+    nodeLimit = limits.nodes;
+    stats = SearchStats();
     timeUp = false;
-    timeBudgetMS = timeLimitMS * BUDGET_PERCENT / 100;
+    stopFlag = limits.stop;
+    ply = 0;
+    lastPublish = startTime;
+    completedDepth = 0;
+    completedScore = 0;
+    completedPV.clear();
+    mateFound.store(false, std::memory_order_relaxed);
 
     // Get legal moves //
     board.setFen(fen);
+    if(nullptr != nnue.Network()) { nnue.Refresh(board); }
     chess::Movelist moves;
-    chess::movegen::legalmoves(moves, board);
+    CHESS_TRACE_CALL("movegen", chess::movegen::legalmoves(moves, board));
     if(0 >= moves.size()) { return ""; } // no legal moves to make, only acceptable time to return nothing
 
+    // Time budget (only a fraction of the allowed time is used) //
+    int64_t timeLimitMS = limits.TimeBudgetMS(board.sideToMove());
+    timeBudgetMS = 0 <= timeLimitMS ? timeLimitMS * BUDGET_PERCENT / 100 : -1;
+
+    // Deep forced mates are far cheaper to prove with PNS than to reach with alpha-beta.
+    // Not in node-limited searches: when the solver finishes depends on the clock, and
+    // it would stop the main search at a different node count on every run.
+    if(0 == limits.nodes && ProofNumberSearch::IsSharp(board)) { StartMateSolver(fen); }
+
+    if(nullptr != recorder) { recorder->BeginMove(board.hash()); }
+
     /*
     // Generate captures first and order them by MVV-LVA for better pruning //
     board.setFen(fen);
@@ -27,49 +49,168 @@ std::string NegaMax::Move(const std::string& fen, int timeLimitMS) {
 
     // Search each depth until time runs out //
     int moveToPlayIndex = 0; // fallback move (always provide a legal move, even if depth 1 times out)
-    for(int depth = 1; depth <= MAX_DEPTH; depth++) {
-        // First layer of search here so the best move can be tracked //
+    int maxDepth = MAX_DEPTH;
+    if(0 < limits.depth) { maxDepth = std::min(maxDepth, limits.depth); }
+    if(0 < limits.mate) { maxDepth = std::min(maxDepth, 2 * limits.mate - 1); } // mate in N == 2N-1 plies
+    int multiPV = std::clamp(limits.multiPV, 1, (int)moves.size());
+    lines.clear();
+    for(int depth = 1; depth <= maxDepth; depth++) {
+        // First layer of search here so the best moves can be tracked //
         int bestMoveIndex;
         int bestScore = -eval.INF;
-        
+        pvLength[0] = 0;
+        uint64_t iterationStartNodes = nodeCount;
+        std::vector<SearchLine> iterationLines; // best first, at most multiPV
+
         for(int i = 0; i < moves.size(); i++) {
-            board.makeMove(moves[i]);
-            int score = -Search(depth-1, -eval.INF, eval.INF);
+            // Only a move beating the current Nth best line matters, so that score is the root alpha //
+            int alpha = (int)iterationLines.size() < multiPV ? -eval.INF : iterationLines.back().score;
+            pathMove[ply] = moves[i].move();
+            pathIndex[ply] = i;
+            MakeMove(moves[i]);
+            int score = -Search(depth-1, -eval.INF, -alpha);
 
-            if(timeUp) { return chess::uci::moveToUci(moves[moveToPlayIndex]); } // time is up, stop searching
+            if(timeUp) { break; } // time is up, stop searching
 
-            board.unmakeMove(moves[i]);
+            UnmakeMove(moves[i]);
+            if(score > alpha) { InsertLine(iterationLines, multiPV, moves[i], score, depth); }
             if(score > bestScore) {
                 bestScore = score;
                 bestMoveIndex = i;
+                UpdatePV(moves[i]);
             }
         }
 
+        if(timeUp) { break; } // partial depth, keep the previous result
+        if(nullptr != recorder) { Record(TreeRecorder::ROOT, depth, -eval.INF, eval.INF, bestScore, bestMoveIndex, moves.size(), nodeCount - iterationStartNodes); }
+
         // Update move to play based on most recent depth of iterative deepening //
         moveToPlayIndex = bestMoveIndex; // depth was completed, update result
-        if(std::abs(bestScore) >= eval.MATE - MAX_DEPTH) { break; } // forced mate found, no need to search further
+        completedDepth = depth;
+        completedScore = bestScore;
+        completedPV = PrincipalVariation();
+        lines = std::move(iterationLines);
+        Publish(false);
+        if(IsMate(bestScore)) { break; } // forced mate found, no need to search further
+        if(mateFound.load(std::memory_order_acquire)) { break; } // the mate solver got there first
+    }
+
+    // Prefer a mate proven by the solver unless this search found one itself //
+    StopMateSolver();
+    bool searchFoundMate = IsMate(completedScore) && 0 < completedScore;
+    if(mateFound.load(std::memory_order_acquire) && !searchFoundMate) {
+        const std::string& mateMove = mateResult.move;
+        for(int i = 0; i < moves.size(); i++) {
+            if(chess::uci::moveToUci(moves[i]) == mateMove) { moveToPlayIndex = i; }
+        }
+        // Scored like a search mate; one the solver couldn't measure still beats every non-mate //
+        completedScore = eval.MATE - (0 < mateResult.plies ? mateResult.plies : MAX_PLY);
+        completedPV = 0 < mateResult.plies ? mateResult.line : mateMove;
+
+        // The proven mate heads the lines //
+        std::erase_if(lines, [&](const SearchLine& line) { return line.move == mateMove; });
+        SearchLine mateLine;
+        mateLine.move = mateMove;
+        mateLine.pv = completedPV;
+        mateLine.score = completedScore;
+        if(0 < mateResult.plies) { mateLine.mateIn = MateIn(completedScore); }
+        mateLine.depth = completedDepth;
+        lines.insert(lines.begin(), mateLine);
+        if((int)lines.size() > multiPV) { lines.pop_back(); }
     }
 
+    stats.nodes = nodeCount;
+    stats.depth = completedDepth;
+    stats.score = completedScore;
+    stats.pawnProbes = eval.Pawns().Probes();
+    stats.pawnHits = eval.Pawns().Hits();
+    stats.pnsMate = mateFound.load(std::memory_order_acquire);
+    Publish(true);
+    if(nullptr != recorder) { recorder->Flush(); }
+
     return chess::uci::moveToUci(moves[moveToPlayIndex]);
 }
 
+int NegaMax::Evaluate(const std::string& fen, int depth) {
+    return Evaluate(chess::Board(fen), depth);
+}
+
+int NegaMax::Evaluate(const chess::Board& position, int depth) {
+    Prepare();
+    startTime = std::chrono::steady_clock::now();
+    lastPublish = startTime;
+    nodeCount = 0;
+    nodeLimit = 0;
+    timeUp = false;
+    stopFlag = nullptr;
+    timeBudgetMS = -1;
+    ply = 0;
+    mateFound.store(false, std::memory_order_relaxed);
+
+    board = position;
+    if(nullptr != nnue.Network()) { nnue.Refresh(board); }
+    if(0 < depth) { return Search(depth, -eval.INF, eval.INF); }
+    return Quiescence(MAX_DEPTH_QUIESCENCE, -eval.INF, eval.INF);
+}
+
+// Tables are sized by the budget as configured now, not as it was when the engine was built
+void NegaMax::Prepare() {
+    tt.SetEvaluation(EvalId()); // stored scores came from another evaluation
+    tt.Reserve();
+    if(nullptr == evalCache) { evalCache = &EvalCache::Shared(); }
+}
+
 // Based on pseudocode from chessprogramming.org
 // https://www.chessprogramming.org/Alpha-Beta#Negamax_Framework
 int NegaMax::Search(int depth, int alpha, int beta) {
+    pvLength[ply] = ply;
+    CHESS_TRACE_COUNT("negamax nodes", 1);
+
     // Check if time is up //
+    uint64_t nodesBefore = nodeCount;
     ++nodeCount;
+    if(0 < nodeLimit && nodeCount >= nodeLimit) { timeUp = true; return 0; } // node budget spent
     if((nodeCount & 1023) == 0) { // only check time every 1024 nodes
         CheckTime();
         if(timeUp) { return 0; } // time is up (score will be discarded)
     }
     
     // Determine if it's time to evaluate yet //
-    if(0 == depth) { return Quiescence(MAX_DEPTH_QUIESCENCE, alpha, beta); }
+    if(0 == depth) {
+        int score = Quiescence(MAX_DEPTH_QUIESCENCE, alpha, beta);
+        if(nullptr != recorder) { Record(TreeRecorder::QUIESCENCE, depth, alpha, beta, score, TreeRecorder::NO_INDEX, 0, 1); }
+        return score;
+    }
+
+    // Transposition table: cut off on a deep enough bound, otherwise try its move first.
+    // An exact score inside the window is searched anyway: it would end the PV here. //
+    uint64_t key = board.hash();
+    uint16_t ttMove = chess::Move::NO_MOVE;
+    TranspositionTable::Entry entry;
+    if(ttSearch) { ++stats.ttProbes; }
+    if(ttSearch && tt.Probe(key, entry)) {
+        ++stats.ttHits;
+        ttMove = entry.move;
+        int ttScore = ScoreFromTT(entry.score);
+        if(entry.depth >= depth) {
+            bool lower = TranspositionTable::LOWER == entry.bound || TranspositionTable::EXACT == entry.bound;
+            bool upper = TranspositionTable::UPPER == entry.bound || TranspositionTable::EXACT == entry.bound;
+            if((lower && ttScore >= beta) || (upper && ttScore <= alpha)) {
+                if(nullptr != recorder) { Record(TreeRecorder::TT_CUTOFF, depth, alpha, beta, ttScore, TreeRecorder::NO_INDEX, 0, 1); }
+                return ttScore;
+            }
+        }
+    }
 
     // Get legal moves //
     chess::Movelist moves;
-    chess::movegen::legalmoves(moves, board);
-    if(0 >= moves.size()) { return eval.Evaluate(board); }
+    CHESS_TRACE_CALL("movegen", chess::movegen::legalmoves(moves, board));
+    if(0 >= moves.size()) { return MatedAtPly(eval.Evaluate(board)); }
+    if(chess::Move::NO_MOVE != ttMove) {
+        for(int i = 1; i < moves.size(); i++) {
+            if(moves[i].move() == ttMove) { std::swap(moves[0], moves[i]); }
+        }
+    }
 
     /*
     // Generate captures first and order them by MVV-LVA for better pruning //
@@ -83,49 +224,115 @@ int NegaMax::Search(int depth, int alpha, int beta) {
     */
 
     // Traverse all moves //
+    int originalAlpha = alpha;
     int bestScore = std::numeric_limits<int>::min();
+    uint16_t bestMove = chess::Move::NO_MOVE;
+    int bestIndex = TreeRecorder::NO_INDEX;
     for(int i = 0; i < moves.size(); i++) {
-        board.makeMove(moves[i]);
+        pathMove[ply] = moves[i].move();
+        pathIndex[ply] = i;
+        MakeMove(moves[i]);
         int score = -Search(depth-1, -beta, -alpha);
 
         if(timeUp) { return 0; } // time is up, stop searching
 
-        board.unmakeMove(moves[i]);
+        UnmakeMove(moves[i]);
         if(score > bestScore) {
             bestScore = score;
-            if(score > alpha) { alpha = score; }
+            if(score > alpha) {
+                alpha = score;
+                bestMove = moves[i].move();
+                bestIndex = i;
+                UpdatePV(moves[i]);
+            }
         }
         if(score >= beta) { i = moves.size(); } // exit the loop
     }
 
+    TranspositionTable::Bound bound = bestScore >= beta ? TranspositionTable::LOWER
+        : bestScore > originalAlpha ? TranspositionTable::EXACT : TranspositionTable::UPPER;
+    if(ttSearch) { tt.Store(key, ScoreToTT(bestScore), bestMove, depth, bound); }
+    if(nullptr != recorder) { Record(TreeRecorder::NEGAMAX, depth, originalAlpha, beta, bestScore, bestIndex, moves.size(), nodeCount - nodesBefore); }
+
     return bestScore;
 }
 
+void NegaMax::Record(TreeRecorder::RecordType type, int depth, int alpha, int beta, int score, int cutoffIndex, int moveCount, uint64_t nodes) {
+    TreeRecorder::SearchRecord record;
+    record.type = type;
+    record.ply = static_cast<uint8_t>(ply);
+    record.depth = static_cast<int8_t>(depth);
+    record.childIndex = 0 < ply ? pathIndex[ply - 1] : TreeRecorder::NO_INDEX;
+    record.cutoffIndex = static_cast<uint8_t>(cutoffIndex);
+    record.moveCount = static_cast<uint8_t>(std::min(moveCount, 255));
+    record.move = 0 < ply ? pathMove[ply - 1] : chess::Move::NO_MOVE;
+    record.hash = board.hash();
+    record.alpha = alpha;
+    record.beta = beta;
+    record.score = score;
+    record.nodes = static_cast<uint32_t>(std::min<uint64_t>(nodes, UINT32_MAX));
+    recorder->Write(record);
+}
+
 void NegaMax::CheckTime() {
-    int timeElapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(
+    int64_t timeElapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - startTime).count();
-    if(timeElapsedMS >= timeBudgetMS) { timeUp = true; }
+    if(0 <= timeBudgetMS && timeElapsedMS >= timeBudgetMS) { timeUp = true; }
+    if(nullptr != stopFlag && stopFlag->load(std::memory_order_relaxed)) { timeUp = true; } // stopped externally
+    if(mateFound.load(std::memory_order_relaxed)) { timeUp = true; } // the mate solver has the answer
+
+    // Periodic telemetry so long iterations still show progress //
+    if(nullptr != telemetry && timeElapsedMS - std::chrono::duration_cast<std::chrono::milliseconds>(
+        lastPublish - startTime).count() >= TELEMETRY_INTERVAL_MS) { Publish(false); }
+}
+
+// Runs until it proves or disproves a mate, spends its node budget, or the main search ends.
+// With every pool worker busy it waits in the queue and may never start: callers that
+// keep workers busy for long (chesscli --batch) leave spare ones for it.
+void NegaMax::StartMateSolver(const std::string& fen) {
+    mateSolver.Reset();
+    mateRunning = true;
+    pnsNodes = 0;
+    mateSolver.Run([this, fen](WorkerState&) {
+        ProofNumberSearch::Result result = pns.Solve(fen, PNS_NODE_LIMIT, &mateSolver.Cancelled());
+        if(result.proven) {
+            mateResult = result;
+            mateFound.store(true, std::memory_order_release);
+        }
+        pnsNodes = result.nodes;
+    });
+}
+
+void NegaMax::StopMateSolver() {
+    if(!mateRunning) { return; }
+    mateSolver.Cancel();
+    mateSolver.Wait();
+    mateRunning = false;
+    stats.pnsNodes = pnsNodes;
 }
 
 int NegaMax::Quiescence(int depth, int alpha, int beta) {
+    pvLength[ply] = ply; // the PV doesn't extend into quiescence
+    CHESS_TRACE_COUNT("quiescence nodes", 1);
+
     // Initial checks (depth, alpha, beta) //
-    int standPat = eval.Evaluate(board); // score if we choose not to capture; serves as lower bound for quiescence search
+    int standPat = MatedAtPly(StaticEval()); // score if we choose not to capture; serves as lower bound for quiescence search
     if(0 == depth) { return standPat; } // cap quiescence search depth to prevent search explosions
     if(standPat >= beta) { return beta; } // no need to capture, position is already excellent
     if(standPat > alpha) { alpha = standPat; } // raise lower bound
 
     // Generate capturing moves only //
     chess::Movelist captures;
-    chess::movegen::legalmoves<chess::movegen::MoveGenType::CAPTURE>(captures, board);
+    CHESS_TRACE_CALL("movegen captures", chess::movegen::legalmoves<chess::movegen::MoveGenType::CAPTURE>(captures, board));
 
     // Order captures by MVV-LVA for better pruning //
     OrderCaptures(captures);
 
     // Iterate through all captures to find the best one //
     for(int i = 0; i < captures.size(); i++) {
-        board.makeMove(captures[i]);
+        MakeMove(captures[i]);
         int score = -Quiescence(depth-1, -beta, -alpha);
-        board.unmakeMove(captures[i]);
+        UnmakeMove(captures[i]);
 
         if(score >= beta) { return beta; } // beta cutoff
         if(score > alpha) { alpha = score; } // found a better capture
@@ -134,7 +341,141 @@ int NegaMax::Quiescence(int depth, int alpha, int beta) {
     return alpha;
 }
 
+// Evaluate() through the shared eval cache. Positions recur constantly across
+// iterative deepening iterations and transpositions, so most stand-pats are hits.
+int NegaMax::StaticEval() {
+    uint64_t hash = board.hash() ^ evalCacheSalt;
+    int score;
+
+    ++stats.evalCacheProbes;
+    if(evalCache->Probe(hash, score)) {
+        ++stats.evalCacheHits;
+        CHESS_TRACE_COUNT("eval cache hits", 1);
+        return score;
+    }
+
+    // Time a sample of the misses to estimate how much time the hits saved //
+    uint64_t misses = stats.evalCacheProbes - stats.evalCacheHits;
+    if(0 == misses % EVAL_TIMING_INTERVAL) {
+        auto before = std::chrono::steady_clock::now();
+        score = UncachedEval();
+        stats.evalTimedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - before).count();
+        ++stats.evalsTimed;
+    }
+    else { score = UncachedEval(); }
+
+    evalCache->Store(hash, score);
+    return score;
+}
+
+// The network knows nothing of mate, so checkmate is scored like Eval::Evaluate() does it
+int NegaMax::UncachedEval() {
+    if(nullptr == nnue.Network()) { return eval.Evaluate(board); }
+    if(board.inCheck()) {
+        chess::Movelist moves;
+        chess::movegen::legalmoves(moves, board);
+        if(0 >= moves.size()) { return -eval.MATE; }
+    }
+    return nnue.Evaluate(board);
+}
+
+void NegaMax::MakeMove(const chess::Move& move) {
+    CHESS_TRACE_SCOPE("makeMove");
+    if(nullptr != nnue.Network()) { nnue.Push(board, move); }
+    board.makeMove(move);
+    ++ply;
+}
+
+void NegaMax::UnmakeMove(const chess::Move& move) {
+    CHESS_TRACE_SCOPE("unmakeMove");
+    --ply;
+    board.unmakeMove(move);
+    if(nullptr != nnue.Network()) { nnue.Pop(); }
+}
+
+// Called after unmaking a root move that beat the Nth best line: keeps `lines` sorted, best first.
+// The move's continuation is still in pvTable[1] from the search that just returned.
+void NegaMax::InsertLine(std::vector<SearchLine>& lines, int multiPV, const chess::Move& move, int score, int depth) {
+    SearchLine line;
+    line.move = chess::uci::moveToUci(move);
+    line.score = score;
+    line.depth = depth;
+    line.pv = line.move;
+    for(int next = 1; next < pvLength[1]; next++) { line.pv += ' ' + chess::uci::moveToUci(pvTable[1][next]); }
+
+    if(IsMate(score)) { line.mateIn = MateIn(score); }
+
+    auto position = std::find_if(lines.begin(), lines.end(), [&](const SearchLine& other) { return score > other.score; });
+    lines.insert(position, line);
+    if((int)lines.size() > multiPV) { lines.pop_back(); }
+}
+
+// Evaluate() scores a mate as -MATE wherever it happens; counting from the root
+// makes a nearer mate score higher (and a later one for the loser less bad)
+int NegaMax::MatedAtPly(int score) const {
+    return -eval.MATE == score ? score + ply : score;
+}
+
+bool NegaMax::IsMate(int score) const {
+    return std::abs(score) >= eval.MATE - MAX_PLY;
+}
+
+// The table is shared by every path to a position, so it stores mates counted from
+// the position itself and every probe re-bases them on its own ply
+int NegaMax::ScoreToTT(int score) const {
+    if(!IsMate(score)) { return score; }
+    return 0 < score ? score + ply : score - ply;
+}
+
+int NegaMax::ScoreFromTT(int score) const {
+    if(!IsMate(score)) { return score; }
+    return 0 < score ? score - ply : score + ply;
+}
+
+// Moves to mate from a root score of MATE - plies (negative when getting mated)
+int NegaMax::MateIn(int score) const {
+    int plies = eval.MATE - std::abs(score);
+    return 0 < score ? (plies + 1) / 2 : -(plies / 2);
+}
+
+// Called after unmaking a move that raised alpha: that move followed by the child's PV
+void NegaMax::UpdatePV(const chess::Move& move) {
+    pvTable[ply][ply] = move;
+    for(int next = ply + 1; next < pvLength[ply + 1]; next++) { pvTable[ply][next] = pvTable[ply + 1][next]; }
+    pvLength[ply] = pvLength[ply + 1];
+}
+
+std::string NegaMax::PrincipalVariation() const {
+    std::string line;
+    for(int i = 0; i < pvLength[0]; i++) {
+        if(0 < i) { line += ' '; }
+        line += chess::uci::moveToUci(pvTable[0][i]);
+    }
+    return line;
+}
+
+void NegaMax::Publish(bool final) {
+    if(nullptr == telemetry) { return; }
+
+    auto now = std::chrono::steady_clock::now();
+    int64_t elapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
+    lastPublish = now;
+
+    TelemetrySample sample;
+    sample.engine = TelemetrySample::Engine::NEGAMAX;
+    sample.final = final;
+    sample.timeMS = elapsedMS;
+    sample.nodes = nodeCount;
+    sample.nps = 0 < elapsedMS ? uint64_t(nodeCount) * 1000 / elapsedMS : 0;
+    sample.depth = completedDepth;
+    sample.score = completedScore;
+    sample.SetPV(completedPV);
+    telemetry->Push(sample);
+}
+
 void NegaMax::OrderCaptures(chess::Movelist& captures) {
+    CHESS_TRACE_SCOPE("OrderCaptures");
     std::sort(captures.begin(), captures.end(),
         [&](const chess::Move& a, const chess::Move& b) {
             return MVVLVA(a) > MVVLVA(b); }
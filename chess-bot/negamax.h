@@ -1,36 +1,153 @@
+#pragma once
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <limits>
 #include <stack>
+#include <thread>
 #include "chess.hpp"
+#include "eval-cache.h"
 #include "evaluation.h"
+#include "nnue.h"
+#include "pns.h"
+#include "search-limits.h"
+#include "search-line.h"
+#include "search-stats.h"
+#include "telemetry.h"
+#include "thread-pool.h"
+#include "trace.h"
+#include "transposition-table.h"
+#include "tree-recorder.h"
 
 class NegaMax {
 public:
-    std::string Move(const std::string& fen, int timeLimitMS);
+    // ttBytes == 0: the transposition table takes the budget's TT share
+    explicit NegaMax(size_t ttBytes = 0) : tt(ttBytes) {}
+
+    std::string Move(const std::string& fen, const SearchLimits& limits);
+
+    const SearchStats& Stats() const { return stats; }
+
+    // Shallow search score in centipawns for the side to move (depth 0 == quiescence only).
+    // No time or node limit; MCTS uses it to evaluate leaves.
+    int Evaluate(const std::string& fen, int depth);
+    int Evaluate(const chess::Board& position, int depth);
+
+    // Best root moves of the last completed iteration, best first (limits.multiPV of them)
+    const std::vector<SearchLine>& Lines() const { return lines; }
+
+    // Use an NNUE network instead of the PST evaluation (nullptr switches back)
+    void SetNetwork(const NNUENetwork* network) {
+        evalCacheSalt = nullptr != network ? network->id : 0;
+        nnue.SetNetwork(network);
+    }
+
+    // Keep the transposition table in a file that outlives the process (see TranspositionTable)
+    // Open it after SetNetwork(), or the file is cleared for the other evaluation
+    bool UseTTFile(const std::string& path, size_t bytes) { return tt.OpenFile(path, bytes, EvalId()); }
+
+    // Allocate the tables from the memory budget now instead of on the first search.
+    // Call it after the budget, SetNetwork() and UseTTFile(); a no-op once they exist.
+    void Prepare();
+
+    // Forget every stored position, so the next search is the same as a fresh engine's
+    // (fixed-node searches reproduce whatever the engine searched before)
+    void ClearTables() { tt.Clear(); }
+
+    // Probe and store the transposition table in Search() (off: the table-less search, for SPRTs)
+    void SetTTSearch(bool enabled) { ttSearch = enabled; }
+
+    // Publish depth/nodes/NPS/score/PV samples while searching (nullptr disables)
+    void SetTelemetry(TelemetryRing* ring) { telemetry = ring; }
+
+    // Stream every searched node to a recorder for offline analysis (nullptr disables)
+    void SetRecorder(TreeRecorder* treeRecorder) { recorder = treeRecorder; }
 
 private:
     // Evaluation
     Eval eval;
+    NNUE nnue;
+    EvalCache* evalCache = nullptr; // the shared cache, looked up on the first search
     chess::Board board;
+    const int EVAL_TIMING_INTERVAL = 16; // time one in every 16 cache misses
+    uint64_t evalCacheSalt = 0; // the network's id: keeps PST and each network's scores apart in the shared cache
+
+    // Transposition table (kept between moves, allocated on the first search)
+    TranspositionTable tt;
+    bool ttSearch = true;
+    uint64_t EvalId() const { return nullptr != nnue.Network() ? nnue.Network()->id : EvalFingerprint(); }
 
     // Iterative Deepening
     const int MAX_DEPTH = 64;
     const int MAX_DEPTH_QUIESCENCE = 6;
     const int BUDGET_PERCENT = 85; // budget to only use 85% of provided time to deal with OS jitter
 
-    int nodeCount;
+    uint64_t nodeLimit; // 0 == no limit
+    uint64_t nodeCount;
+    SearchStats stats;
+    std::vector<SearchLine> lines;
     bool timeUp;
+    const std::atomic<bool>* stopFlag; // set by another thread to end the search early
     std::chrono::steady_clock::time_point startTime;
 
-    int timeBudgetMS;
+    int64_t timeBudgetMS; // -1 == no time limit
+
+    // Mate solver (proof-number search as a pool task in sharp positions)
+    const uint64_t PNS_NODE_LIMIT = 4000000;
+    ProofNumberSearch pns;
+    TaskGroup mateSolver; // after pns: cancelled and waited for before it goes
+    bool mateRunning = false;
+    std::atomic<bool> mateFound;
+    ProofNumberSearch::Result mateResult; // written before mateFound is set
+    uint64_t pnsNodes;
+
+    // Principal variation (triangular PV table)
+    static constexpr int MAX_PLY = 128;
+    chess::Move pvTable[MAX_PLY][MAX_PLY];
+    int pvLength[MAX_PLY];
+    int ply;
+
+    // Tree recording: the move (and its index) played at each ply on the current path
+    TreeRecorder* recorder = nullptr;
+    uint16_t pathMove[MAX_PLY];
+    uint8_t pathIndex[MAX_PLY];
+    void Record(TreeRecorder::RecordType type, int depth, int alpha, int beta, int score, int cutoffIndex, int moveCount, uint64_t nodes);
+
+    // Telemetry
+    const int TELEMETRY_INTERVAL_MS = 50;
+    TelemetryRing* telemetry = nullptr;
+    std::chrono::steady_clock::time_point lastPublish;
+    int completedDepth;
+    int completedScore;
+    std::string completedPV;
     
     // Functions
     int Search(int depth, int alpha, int beta);
 
     void CheckTime();
 
+    void StartMateSolver(const std::string& fen);
+    void StopMateSolver();
+
     int Quiescence(int depth, int alpha, int beta);
+    int StaticEval();
+    int UncachedEval();
+
+    // makeMove/unmakeMove that also keep the NNUE accumulator in sync
+    void MakeMove(const chess::Move& move);
+    void UnmakeMove(const chess::Move& move);
+    void UpdatePV(const chess::Move& move);
+
+    // Mate scores: MATE - plies from the root to the mate //
+    int MatedAtPly(int score) const;
+    bool IsMate(int score) const;
+    int MateIn(int score) const;
+    int ScoreToTT(int score) const;
+    int ScoreFromTT(int score) const;
+    void InsertLine(std::vector<SearchLine>& lines, int multiPV, const chess::Move& move, int score, int depth);
+    std::string PrincipalVariation() const;
+    void Publish(bool final);
+
     void OrderCaptures(chess::Movelist& captures);
     int MVVLVA(chess::Move capture);
 };
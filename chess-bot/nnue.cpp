@@ -0,0 +1,230 @@
+#include "nnue.h"
+#include "trace.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#ifdef CHESS_NNUE_EMBEDDED
+#include "nnue-embedded.h" // generated by CMake: NNUE_EMBEDDED_DATA, NNUE_EMBEDDED_SIZE
+#endif
+
+namespace {
+constexpr int HIDDEN = NNUENetwork::HIDDEN;
+
+// ---------------------------------------- Kernels ---------------------------------------- //
+
+// dst = src + sum(adds) - sum(subs)
+// Fused so each block of neurons is loaded and stored once per move.
+void ApplyDelta(const int16_t* src, int16_t* dst,
+                const int16_t* const* adds, int numAdds,
+                const int16_t* const* subs, int numSubs) {
+#if defined(__AVX2__)
+    for(int i = 0; i < HIDDEN; i += 16) {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(src + i));
+        for(int a = 0; a < numAdds; a++) {
+            v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(adds[a] + i)));
+        }
+        for(int s = 0; s < numSubs; s++) {
+            v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(subs[s] + i)));
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+#elif defined(__SSE2__)
+    for(int i = 0; i < HIDDEN; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(src + i));
+        for(int a = 0; a < numAdds; a++) {
+            v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(adds[a] + i)));
+        }
+        for(int s = 0; s < numSubs; s++) {
+            v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(subs[s] + i)));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+#else
+    for(int i = 0; i < HIDDEN; i++) {
+        int16_t v = src[i];
+        for(int a = 0; a < numAdds; a++) { v += adds[a][i]; }
+        for(int s = 0; s < numSubs; s++) { v -= subs[s][i]; }
+        dst[i] = v;
+    }
+#endif
+}
+
+// sum(clamp(x, 0, QA) * w) over one perspective's accumulator
+int32_t ClippedDot(const int16_t* x, const int16_t* w) {
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(NNUENetwork::QA);
+    __m256i sum = _mm256_setzero_si256();
+    for(int i = 0; i < HIDDEN; i += 16) {
+        __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(x + i));
+        v = _mm256_min_epi16(_mm256_max_epi16(v, zero), qa);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i*>(w + i))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(NNUENetwork::QA);
+    __m128i sum = _mm_setzero_si128();
+    for(int i = 0; i < HIDDEN; i += 8) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(x + i));
+        v = _mm_min_epi16(_mm_max_epi16(v, zero), qa);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i*>(w + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+#else
+    int32_t sum = 0;
+    for(int i = 0; i < HIDDEN; i++) {
+        int32_t v = std::min<int32_t>(std::max<int32_t>(x[i], 0), NNUENetwork::QA);
+        sum += v * w[i];
+    }
+    return sum;
+#endif
+}
+} // namespace
+
+// ---------------------------------------- NNUENetwork ---------------------------------------- //
+
+std::unique_ptr<NNUENetwork> NNUENetwork::Load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if(!file) { return nullptr; }
+
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return LoadFromMemory(data.data(), data.size());
+}
+
+std::unique_ptr<NNUENetwork> NNUENetwork::LoadFromMemory(const unsigned char* data, size_t size) {
+    // Validate header //
+    const size_t headerSize = 4 + 3 * sizeof(uint32_t);
+    const size_t bodySize = sizeof(featureWeights) + sizeof(featureBias) + sizeof(outputWeights) + sizeof(outputBias);
+    if(nullptr == data || size != headerSize + bodySize) { return nullptr; }
+    if(0 != std::memcmp(data, "CNUE", 4)) { return nullptr; }
+
+    uint32_t header[3];
+    std::memcpy(header, data + 4, sizeof(header));
+    if(VERSION != header[0] || INPUTS != header[1] || HIDDEN != header[2]) { return nullptr; }
+
+    // Copy weights //
+    auto net = std::make_unique<NNUENetwork>();
+    const unsigned char* cursor = data + headerSize;
+    std::memcpy(net->featureWeights, cursor, sizeof(featureWeights)); cursor += sizeof(featureWeights);
+    std::memcpy(net->featureBias, cursor, sizeof(featureBias));       cursor += sizeof(featureBias);
+    std::memcpy(net->outputWeights, cursor, sizeof(outputWeights));   cursor += sizeof(outputWeights);
+    std::memcpy(&net->outputBias, cursor, sizeof(outputBias));
+
+    // FNV-1a over the weights //
+    net->id = 0xCBF29CE484222325ULL;
+    for(size_t i = headerSize; i < size; i++) { net->id = (net->id ^ data[i]) * 0x100000001B3ULL; }
+
+    return net;
+}
+
+const NNUENetwork* NNUENetwork::Embedded() {
+#ifdef CHESS_NNUE_EMBEDDED
+    static std::unique_ptr<NNUENetwork> net = LoadFromMemory(NNUE_EMBEDDED_DATA, NNUE_EMBEDDED_SIZE);
+    return net.get();
+#else
+    return nullptr;
+#endif
+}
+
+// ---------------------------------------- NNUE ---------------------------------------- //
+
+// perspective 0 == white, 1 == black (board flipped so "our" pieces always come first)
+int NNUE::FeatureIndex(int perspective, chess::Piece piece, int square) {
+    int color = piece.color() == chess::Color::WHITE ? 0 : 1;
+    int type = static_cast<int>(piece.type());
+    if(1 == perspective) {
+        color ^= 1;
+        square ^= 56;
+    }
+    return color * 384 + type * 64 + square;
+}
+
+void NNUE::Refresh(const chess::Board& board) {
+    top = 0;
+    Accumulator& acc = stack[0];
+
+    for(int perspective = 0; perspective < 2; perspective++) {
+        std::memcpy(acc.values[perspective], net->featureBias, sizeof(net->featureBias));
+
+        for(uint64_t occ = board.occ().getBits(); occ; occ &= occ - 1) {
+            int sq = std::countr_zero(occ);
+            const int16_t* row = net->featureWeights + FeatureIndex(perspective, board.at(sq), sq) * HIDDEN;
+            ApplyDelta(acc.values[perspective], acc.values[perspective], &row, 1, nullptr, 0);
+        }
+    }
+}
+
+void NNUE::Push(const chess::Board& board, const chess::Move& move) {
+    const Accumulator& prev = stack[top];
+    Accumulator& next = stack[++top];
+
+    int from = move.from().index();
+    int to = move.to().index();
+    chess::Piece mover = board.at(from);
+
+    // Collect the pieces that appear/disappear (at most 2 each, for castling) //
+    chess::Piece added[2], removed[2];
+    int addedSq[2], removedSq[2];
+    int numAdded = 0, numRemoved = 0;
+
+    if(chess::Move::CASTLING == move.typeOf()) {
+        // king "captures" its own rook in this move encoding
+        bool kingSide = to > from;
+        int rank = from & 56;
+        added[numAdded] = mover;          addedSq[numAdded++] = rank + (kingSide ? 6 : 2);
+        added[numAdded] = board.at(to);   addedSq[numAdded++] = rank + (kingSide ? 5 : 3);
+        removed[numRemoved] = mover;        removedSq[numRemoved++] = from;
+        removed[numRemoved] = board.at(to); removedSq[numRemoved++] = to;
+    }
+    else {
+        chess::Piece placed = chess::Move::PROMOTION == move.typeOf()
+            ? chess::Piece(move.promotionType(), mover.color()) : mover;
+        added[numAdded] = placed;    addedSq[numAdded++] = to;
+        removed[numRemoved] = mover; removedSq[numRemoved++] = from;
+
+        int capturedSq = chess::Move::ENPASSANT == move.typeOf() ? (from & 56) | (to & 7) : to;
+        chess::Piece captured = board.at(capturedSq);
+        if(chess::Piece::NONE != captured.internal()) {
+            removed[numRemoved] = captured; removedSq[numRemoved++] = capturedSq;
+        }
+    }
+
+    // Update both perspectives //
+    for(int perspective = 0; perspective < 2; perspective++) {
+        const int16_t* adds[2];
+        const int16_t* subs[2];
+        for(int i = 0; i < numAdded; i++) {
+            adds[i] = net->featureWeights + FeatureIndex(perspective, added[i], addedSq[i]) * HIDDEN;
+        }
+        for(int i = 0; i < numRemoved; i++) {
+            subs[i] = net->featureWeights + FeatureIndex(perspective, removed[i], removedSq[i]) * HIDDEN;
+        }
+        ApplyDelta(prev.values[perspective], next.values[perspective], adds, numAdded, subs, numRemoved);
+    }
+}
+
+int NNUE::Evaluate(const chess::Board& board) const {
+    CHESS_TRACE_SCOPE("NNUE::Evaluate");
+    const Accumulator& acc = stack[top];
+    int us = board.sideToMove() == chess::Color::WHITE ? 0 : 1;
+
+    int64_t output = ClippedDot(acc.values[us], net->outputWeights)
+                   + ClippedDot(acc.values[us ^ 1], net->outputWeights + HIDDEN)
+                   + net->outputBias;
+
+    return static_cast<int>(output * NNUENetwork::SCALE / (NNUENetwork::QA * NNUENetwork::QB));
+}
@@ -0,0 +1,68 @@
+// Small quantized NNUE-style evaluator
+// https://www.chessprogramming.org/NNUE
+//
+// Architecture: (768 -> 256) x 2 perspectives -> 1
+// Features are piece type x colour x square, seen from each side's point of view.
+// The first layer lives in an accumulator that is updated incrementally on
+// make/unmake (Push/Pop) instead of being recomputed at every leaf.
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "chess.hpp"
+
+struct NNUENetwork {
+    static constexpr int INPUTS = 768;
+    static constexpr int HIDDEN = 256;
+    static constexpr int QA = 255;    // accumulator quantization
+    static constexpr int QB = 64;     // output weight quantization
+    static constexpr int SCALE = 400; // network output -> centipawns
+
+    alignas(64) int16_t featureWeights[INPUTS * HIDDEN]; // input-major: one row of HIDDEN per feature
+    alignas(64) int16_t featureBias[HIDDEN];
+    alignas(64) int16_t outputWeights[2 * HIDDEN];        // side to move first, then opponent
+    int32_t outputBias;
+    uint64_t id = 0; // hash of the weights, tells networks apart (e.g. for the TT file)
+
+    // File layout (little-endian):
+    // "CNUE", uint32 version, uint32 inputs, uint32 hidden, then the arrays above in order.
+    static std::unique_ptr<NNUENetwork> Load(const std::string& path);
+    static std::unique_ptr<NNUENetwork> LoadFromMemory(const unsigned char* data, size_t size);
+
+    // Network compiled into the binary (CHESS_NNUE_EMBED_FILE in CMake), or nullptr
+    static const NNUENetwork* Embedded();
+
+    static constexpr uint32_t VERSION = 1;
+};
+
+class NNUE {
+public:
+    NNUE() : stack(new Accumulator[MAX_PLY]) {}
+
+    void SetNetwork(const NNUENetwork* network) { net = network; }
+    const NNUENetwork* Network() const { return net; }
+
+    // Rebuild the accumulator from scratch (start of a search)
+    void Refresh(const chess::Board& board);
+
+    // Call Push *before* board.makeMove(move) and Pop *after* board.unmakeMove(move)
+    void Push(const chess::Board& board, const chess::Move& move);
+    void Pop() { --top; }
+
+    // Score from the side to move's perspective, in centipawns
+    int Evaluate(const chess::Board& board) const;
+
+private:
+    static constexpr int MAX_PLY = 256;
+
+    struct Accumulator {
+        alignas(64) int16_t values[2][NNUENetwork::HIDDEN]; // [perspective][neuron]
+    };
+
+    const NNUENetwork* net = nullptr;
+    std::unique_ptr<Accumulator[]> stack;
+    int top = 0;
+
+    static int FeatureIndex(int perspective, chess::Piece piece, int square);
+};
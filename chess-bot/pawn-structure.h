@@ -0,0 +1,157 @@
+// Pawn structure evaluation backed by a pawn hash table
+// https://www.chessprogramming.org/Pawn_Structure
+// https://www.chessprogramming.org/Pawn_Hash_Table
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include "chess.hpp"
+#include "memory-budget.h"
+
+class PawnTable {
+public:
+    // Pawn structures repeat so much that a few MB already hit almost every time
+    explicit PawnTable(size_t bytes = std::min(MAX_BYTES, MemoryBudget::Global().Share(MemoryComponent::PAWN_TABLE)))
+        : block(MemoryBudget::Global().Allocate(MemoryComponent::PAWN_TABLE, bytes)),
+          entries(block.As<Entry>()), mask(block.Size() / sizeof(Entry) - 1) {}
+
+    // Returns the pawn structure score from white's perspective.
+    // Pawn structure changes rarely during search, so most calls are table hits.
+    int Probe(const chess::Board& board) {
+        uint64_t white = board.pieces(chess::PieceType::PAWN, chess::Color::WHITE).getBits();
+        uint64_t black = board.pieces(chess::PieceType::PAWN, chess::Color::BLACK).getBits();
+        uint64_t key = Key(white, black);
+
+        ++probes;
+        Entry& entry = entries[key & mask];
+        if(entry.key == key) {
+            ++hits;
+            return entry.score;
+        }
+
+        entry.key = key;
+        entry.score = Evaluate(white, black);
+        return entry.score;
+    }
+
+    void Clear() {
+        std::fill(entries, entries + mask + 1, Entry{});
+        probes = 0;
+        hits = 0;
+    }
+
+    uint64_t Probes() const { return probes; }
+    uint64_t Hits() const { return hits; }
+    double HitRate() const { return 0 < probes ? double(hits) / probes : 0.0; }
+
+    // The terms folded into an FNV-1a hash (see EvalFingerprint())
+    static uint64_t Fingerprint(uint64_t hash) {
+        for(int term : { DOUBLED, ISOLATED, BACKWARD }) { hash = (hash ^ uint32_t(term)) * 0x100000001B3ULL; }
+        for(int term : PASSED) { hash = (hash ^ uint32_t(term)) * 0x100000001B3ULL; }
+        return hash;
+    }
+
+    // Pawn-only Zobrist key (one random number per colour/square)
+    static uint64_t Key(uint64_t white, uint64_t black) {
+        uint64_t key = KEY_SEED; // nonzero so pawnless positions don't match empty entries
+        for(; white; white &= white - 1) { key ^= ZOBRIST[std::countr_zero(white)]; }
+        for(; black; black &= black - 1) { key ^= ZOBRIST[64 + std::countr_zero(black)]; }
+        return key;
+    }
+
+private:
+    struct Entry {
+        uint64_t key = 0;
+        int score = 0;
+    };
+
+    static constexpr size_t MAX_BYTES = size_t(4) << 20;
+
+    MemoryBlock block; // zeroed: key 0 never matches (see KEY_SEED)
+    Entry* entries;
+    uint64_t mask;
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+
+    // Terms //
+    static constexpr int DOUBLED = -10;  // per extra pawn on a file
+    static constexpr int ISOLATED = -15; // no friendly pawns on adjacent files
+    static constexpr int BACKWARD = -8;  // can't be supported and its stop square is attacked
+    static constexpr int PASSED[8] = { 0, 5, 10, 20, 35, 60, 100, 0 }; // by relative rank
+
+    static constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+    static constexpr uint64_t NOT_FILE_A = ~FILE_A;
+    static constexpr uint64_t NOT_FILE_H = ~(FILE_A << 7);
+
+    static int Evaluate(uint64_t white, uint64_t black) {
+        return EvaluateSide(white, black, true) - EvaluateSide(black, white, false);
+    }
+
+    static int EvaluateSide(uint64_t us, uint64_t them, bool isWhite) {
+        int score = 0;
+
+        // Squares attacked by enemy pawns (for backward pawns) //
+        uint64_t enemyAttacks = isWhite
+            ? ((them & NOT_FILE_A) >> 9) | ((them & NOT_FILE_H) >> 7)
+            : ((them & NOT_FILE_H) << 9) | ((them & NOT_FILE_A) << 7);
+
+        for(int file = 0; file < 8; file++) {
+            uint64_t fileMask = FILE_A << file;
+            int count = std::popcount(us & fileMask);
+            if(1 < count) { score += DOUBLED * (count - 1); }
+            if(0 < count && 0 == (us & AdjacentFiles(file))) { score += ISOLATED * count; }
+        }
+
+        for(uint64_t pawns = us; pawns; pawns &= pawns - 1) {
+            int sq = std::countr_zero(pawns);
+            int file = sq & 7;
+            int rank = sq >> 3;
+            int relativeRank = isWhite ? rank : 7 - rank;
+
+            uint64_t adjacent = AdjacentFiles(file);
+            uint64_t ahead = Ahead(rank, isWhite);
+
+            // Passed: no enemy pawns ahead on this or adjacent files
+            if(0 == (them & (adjacent | (FILE_A << file)) & ahead)) { score += PASSED[relativeRank]; }
+
+            // Backward: no friendly pawns beside or behind on adjacent files, and stop square attacked
+            uint64_t besideOrBehind = adjacent & ~ahead;
+            int stop = isWhite ? sq + 8 : sq - 8;
+            if(0 <= stop && stop < 64 && 0 == (us & besideOrBehind) && (enemyAttacks & (uint64_t(1) << stop))) {
+                score += BACKWARD;
+            }
+        }
+
+        return score;
+    }
+
+    static uint64_t AdjacentFiles(int file) {
+        uint64_t mask = 0;
+        if(0 < file) { mask |= FILE_A << (file - 1); }
+        if(7 > file) { mask |= FILE_A << (file + 1); }
+        return mask;
+    }
+
+    // All ranks strictly in front of the given rank, from the side's perspective
+    static uint64_t Ahead(int rank, bool isWhite) {
+        if(isWhite) { return 7 == rank ? 0 : ~uint64_t(0) << (8 * (rank + 1)); }
+        return 0 == rank ? 0 : ~uint64_t(0) >> (8 * (8 - rank));
+    }
+
+    static constexpr uint64_t KEY_SEED = 0x9E3779B97F4A7C15ULL;
+
+    // splitmix64, so the keys are fixed at compile time
+    static constexpr std::array<uint64_t, 128> ZOBRIST = [] {
+        std::array<uint64_t, 128> keys{};
+        uint64_t state = 0x2545F4914F6CDD1DULL;
+        for(auto& key : keys) {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            key = z ^ (z >> 31);
+        }
+        return keys;
+    }();
+};
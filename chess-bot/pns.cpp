@@ -0,0 +1,263 @@
+#include "pns.h"
+#include <algorithm>
+
+// ---------------------------------------- ProofNumberSearch (process) ---------------------------------------- //
+
+ProofNumberSearch::Result ProofNumberSearch::Solve(const std::string& fen, uint64_t maxNodes, const std::atomic<bool>* stop) {
+    Result result;
+    board.setFen(fen);
+    ply = 0;
+    nodes = 0;
+    this->maxNodes = maxNodes;
+    stopFlag = stop;
+    aborted = false;
+    if(nullptr == table) {
+        block = MemoryBudget::Global().Allocate(MemoryComponent::MATE_SOLVER, tableBytes);
+        table = block.As<Entry>();
+        mask = block.Size() / sizeof(Entry) - 1;
+    }
+    else { std::fill(table, table + mask + 1, Entry()); } // a new block is already zeroed
+
+    // Grow the thresholds until the root is proven, disproven, or the budget is spent //
+    MID(INF - 1, INF - 1);
+    result.nodes = nodes;
+
+    if(aborted) { return result; }
+
+    // Proven: measure the mate through the table and walk it, the attacker taking its
+    // quickest check and the defender its longest defence //
+    std::unordered_map<uint64_t, int> distances;
+    uint64_t budget = MATE_WALK_LIMIT;
+    int plies = MateDistance(distances, budget);
+    if(0 < plies) {
+        result.proven = true;
+        result.plies = plies;
+        bool extended = true;
+        for(int remaining = plies; 0 < remaining && extended; remaining--) {
+            chess::Movelist moves;
+            GenerateMoves(moves);
+            extended = false;
+            for(int i = 0; i < moves.size() && !extended; i++) {
+                board.makeMove(moves[i]);
+                auto child = distances.find(board.hash());
+                if(child != distances.end() && remaining - 1 == child->second) {
+                    if(!result.line.empty()) { result.line += ' '; }
+                    result.line += chess::uci::moveToUci(moves[i]);
+                    ++ply;
+                    extended = true;
+                }
+                else { board.unmakeMove(moves[i]); }
+            }
+        }
+        result.move = result.line.substr(0, result.line.find(' '));
+        return result;
+    }
+
+    // Part of the proof was evicted: play the checking move whose reply position is lost
+    // for the defender. Looking at the children (not the root entry) survives the root being evicted.
+    chess::Movelist moves;
+    GenerateMoves(moves);
+    for(int i = 0; i < moves.size(); i++) {
+        uint32_t phi, delta;
+        board.makeMove(moves[i]);
+        Lookup(board.hash(), phi, delta);
+        board.unmakeMove(moves[i]);
+        if(0 == delta) {
+            result.proven = true;
+            result.move = chess::uci::moveToUci(moves[i]);
+            break;
+        }
+    }
+    return result;
+}
+
+// Plies to mate from the current position through the proven part of the table: the
+// attacker's quickest check, the defender's longest defence. -1 when part of the proof
+// was evicted (or the walk spent its budget).
+int ProofNumberSearch::MateDistance(std::unordered_map<uint64_t, int>& distances, uint64_t& budget) {
+    uint64_t key = board.hash();
+    auto known = distances.find(key);
+    if(known != distances.end()) { return known->second; }
+    if(0 == budget || MAX_PLY <= ply) { return -1; }
+    --budget;
+    distances[key] = -1; // on the walk: transposing back into it proves nothing
+
+    bool attacker = AttackerToMove();
+    chess::Movelist moves;
+    GenerateMoves(moves);
+    int best = attacker ? -1 : 0;
+    if(0 >= moves.size()) { best = !attacker && board.inCheck() ? 0 : -1; } // mated, or stuck without checks
+
+    for(int i = 0; i < moves.size(); i++) {
+        // Attacker: only checks into lost positions. Defender: every reply must lose. //
+        uint32_t phi, delta;
+        board.makeMove(moves[i]);
+        ++ply;
+        Lookup(board.hash(), phi, delta);
+        int plies = (attacker ? 0 == delta : 0 == phi) ? MateDistance(distances, budget) : -1;
+        --ply;
+        board.unmakeMove(moves[i]);
+
+        if(attacker) {
+            if(0 <= plies && (0 > best || plies + 1 < best)) { best = plies + 1; }
+        }
+        else if(0 > plies) {
+            best = -1;
+            break;
+        }
+        else { best = std::max(best, plies + 1); }
+    }
+
+    distances[key] = best;
+    return best;
+}
+
+// Multiple iterative deepening: expand the most-proving child until this node's
+// numbers cross one of the thresholds, then return to the parent.
+void ProofNumberSearch::MID(uint32_t thresholdPhi, uint32_t thresholdDelta) {
+    ++nodes;
+    if(nodes >= maxNodes) { aborted = true; }
+    if((nodes & 1023) == 0 && nullptr != stopFlag && stopFlag->load(std::memory_order_relaxed)) { aborted = true; }
+    if(aborted) { return; }
+
+    uint64_t key = board.hash();
+    chess::Movelist moves;
+    GenerateMoves(moves);
+    if(0 >= moves.size()) {
+        // Attacker out of checks, defender mated, or defender stalemated //
+        bool sideToMoveWins = !AttackerToMove() && !board.inCheck();
+        Store(key, sideToMoveWins ? 0 : INF, sideToMoveWins ? INF : 0);
+        return;
+    }
+
+    // Children past the horizon or repeating the path count as failed attacks.
+    // They depend on the path, so they are never stored in the table.
+    uint64_t childKeys[256];
+    bool blocked[256];
+    for(int i = 0; i < moves.size(); i++) {
+        board.makeMove(moves[i]);
+        childKeys[i] = board.hash();
+        blocked[i] = MAX_PLY <= ply + 1 || board.isRepetition(1);
+        board.unmakeMove(moves[i]);
+    }
+
+    while(true) {
+        // phi = min child delta, delta = sum of child phi //
+        uint32_t phi = INF;
+        uint32_t delta = 0;
+        int best = 0;
+        uint32_t bestDelta = INF;
+        uint32_t secondDelta = INF;
+        uint32_t bestPhi = INF;
+        for(int i = 0; i < moves.size(); i++) {
+            uint32_t childPhi, childDelta;
+            if(blocked[i]) {
+                bool childIsAttacker = !AttackerToMove();
+                childPhi = childIsAttacker ? INF : 0;
+                childDelta = childIsAttacker ? 0 : INF;
+            }
+            else { Lookup(childKeys[i], childPhi, childDelta); }
+            phi = std::min(phi, childDelta);
+            delta = std::min<uint32_t>(INF, delta + childPhi);
+
+            if(childDelta < bestDelta) {
+                secondDelta = bestDelta;
+                bestDelta = childDelta;
+                bestPhi = childPhi;
+                best = i;
+            }
+            else if(childDelta < secondDelta) { secondDelta = childDelta; }
+        }
+
+        Store(key, phi, delta);
+        if(phi >= thresholdPhi || delta >= thresholdDelta || aborted) { return; }
+
+        // Child thresholds: stay with the most-proving child until the runner-up catches up //
+        uint32_t childThresholdPhi = std::min<uint64_t>(INF - 1, uint64_t(thresholdDelta) - delta + bestPhi);
+        uint32_t childThresholdDelta = std::min<uint32_t>(thresholdPhi, secondDelta + 1);
+
+        board.makeMove(moves[best]);
+        ++ply;
+        MID(childThresholdPhi, childThresholdDelta);
+        --ply;
+        board.unmakeMove(moves[best]);
+    }
+}
+
+// ---------------------------------------- ProofNumberSearch (helper) ---------------------------------------- //
+
+// Attacker: checking moves only. Defender: every legal move.
+void ProofNumberSearch::GenerateMoves(chess::Movelist& moves) {
+    chess::movegen::legalmoves(moves, board);
+    if(!AttackerToMove()) { return; }
+
+    chess::Movelist checks;
+    for(int i = 0; i < moves.size(); i++) {
+        board.makeMove(moves[i]);
+        if(board.inCheck()) { checks.add(moves[i]); }
+        board.unmakeMove(moves[i]);
+    }
+    moves = checks;
+}
+
+void ProofNumberSearch::Lookup(uint64_t key, uint32_t& phi, uint32_t& delta) const {
+    const Entry* bucket = &table[key & mask & ~uint64_t(1)];
+    for(int way = 0; way < 2; way++) {
+        const Entry& entry = bucket[way];
+        if(key == entry.key && (0 != entry.phi || 0 != entry.delta)) {
+            phi = entry.phi;
+            delta = entry.delta;
+            return;
+        }
+    }
+    phi = delta = 1;
+}
+
+// Two-way buckets. A store is never refused: a child that couldn't be stored would
+// read as (1, 1) after every visit, and its parent would select it again until the
+// node budget ran out. Proofs and disproofs are only evicted when both ways hold one.
+void ProofNumberSearch::Store(uint64_t key, uint32_t phi, uint32_t delta) {
+    Entry* bucket = &table[key & mask & ~uint64_t(1)];
+    auto keep = [](const Entry& entry) { // 0: empty, 1: unresolved, 2: proof or disproof
+        if(0 == entry.phi && 0 == entry.delta) { return 0; }
+        return 0 == entry.phi || 0 == entry.delta ? 2 : 1;
+    };
+
+    Entry* slot = key == bucket[1].key ? &bucket[1] : &bucket[0];
+    if(key != slot->key && keep(bucket[1]) < keep(bucket[0])) { slot = &bucket[1]; }
+
+    slot->key = key;
+    slot->phi = phi;
+    slot->delta = delta;
+}
+
+// Cheap gate for running the solver at all: several checks available, or
+// the enemy king already has most of its escape squares covered.
+bool ProofNumberSearch::IsSharp(chess::Board& board) {
+    chess::Movelist moves;
+    chess::movegen::legalmoves(moves, board);
+    int checks = 0;
+    for(int i = 0; i < moves.size(); i++) {
+        board.makeMove(moves[i]);
+        if(board.inCheck()) { ++checks; }
+        board.unmakeMove(moves[i]);
+    }
+    if(2 <= checks) { return true; }
+
+    chess::Color us = board.sideToMove();
+    chess::Square king = board.kingSq(~us);
+    int covered = 0;
+    int squares = 0;
+    for(int dr = -1; dr <= 1; dr++) {
+        for(int df = -1; df <= 1; df++) {
+            int rank = king.rank() + dr;
+            int file = king.file() + df;
+            if((0 == dr && 0 == df) || 0 > rank || 7 < rank || 0 > file || 7 < file) { continue; }
+
+            chess::Square square(rank * 8 + file);
+            ++squares;
+            if(board.isAttacked(square, us) || board.at(square).color() == ~us) { ++covered; }
+        }
+    }
+    return 0 < checks && covered == squares;
+}
@@ -0,0 +1,71 @@
+// Depth-first proof-number search (df-pn) for forced mates
+// https://www.chessprogramming.org/Proof-Number_Search
+// Based on Nagai's df-pn in the phi/delta formulation: phi is the proof number
+// for the side to move "winning" (attacker: mating, defender: escaping) and
+// delta is its disproof number.
+//
+// The attacker only considers checking moves, so the search follows forcing
+// lines and proves mates far deeper than the alpha-beta search reaches.
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "chess.hpp"
+#include "memory-budget.h"
+
+class ProofNumberSearch {
+public:
+    struct Result {
+        bool proven = false;
+        std::string move; // first move of the mate, UCI
+        int plies = 0;    // to mate against the longest defence, 0 == unknown (proof partly evicted)
+        std::string line; // UCI moves of that mate, starting with move
+        uint64_t nodes = 0;
+    };
+
+    // The table is taken from the memory budget on the first Solve()
+    explicit ProofNumberSearch(size_t tableBytes = std::min(MAX_TABLE_BYTES, MemoryBudget::Global().Share(MemoryComponent::MATE_SOLVER)))
+        : tableBytes(tableBytes) {}
+
+    // Try to prove a forced mate for the side to move within maxNodes nodes.
+    Result Solve(const std::string& fen, uint64_t maxNodes, const std::atomic<bool>* stop = nullptr);
+
+    // Worth running: checks available or an exposed enemy king
+    static bool IsSharp(chess::Board& board);
+
+private:
+    static constexpr uint32_t INF = 100000000;
+    static constexpr int MAX_PLY = 64;
+    static constexpr size_t MAX_TABLE_BYTES = size_t(4) << 20;
+    static constexpr uint64_t MATE_WALK_LIMIT = 1000000; // positions visited measuring a proven mate
+
+    struct Entry {
+        uint64_t key = 0;
+        uint32_t phi = 0;
+        uint32_t delta = 0;
+    };
+
+    // Bounded, two-way buckets; unknown positions start at phi = delta = 1
+    size_t tableBytes;
+    MemoryBlock block;
+    Entry* table = nullptr;
+    uint64_t mask = 0;
+
+    chess::Board board;
+    int ply;
+    uint64_t nodes;
+    uint64_t maxNodes;
+    const std::atomic<bool>* stopFlag;
+    bool aborted;
+
+    void MID(uint32_t thresholdPhi, uint32_t thresholdDelta);
+    void GenerateMoves(chess::Movelist& moves);
+    void Lookup(uint64_t key, uint32_t& phi, uint32_t& delta) const;
+    void Store(uint64_t key, uint32_t phi, uint32_t delta);
+    int MateDistance(std::unordered_map<uint64_t, int>& distances, uint64_t& budget);
+
+    bool AttackerToMove() const { return 0 == (ply & 1); }
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include "chess.hpp"
+
+// What a search may spend, shared by NegaMax and MCTS (UCI "go" semantics).
+// Every field is optional; a zero value means "no limit of this kind".
+struct SearchLimits {
+    int depth = 0;           // NegaMax: iterations; MCTS: tree depth
+    uint64_t nodes = 0;      // NegaMax: nodes; MCTS: playouts
+    int64_t movetimeMS = 0;  // fixed time for this move
+    int mate = 0;            // look for a mate in this many moves (NegaMax)
+    int multiPV = 1;         // number of best root moves to report (see Lines())
+
+    // clock //
+    int64_t wtimeMS = 0;
+    int64_t btimeMS = 0;
+    int64_t wincMS = 0;
+    int64_t bincMS = 0;
+    int movesToGo = 0;       // moves until the next time control, 0 == sudden death
+
+    bool infinite = false;   // search until stopped
+    const std::atomic<bool>* stop = nullptr; // set by another thread to end the search
+
+    static SearchLimits MoveTime(int64_t ms, const std::atomic<bool>* stop = nullptr) {
+        SearchLimits limits;
+        limits.movetimeMS = ms;
+        limits.stop = stop;
+        return limits;
+    }
+
+    bool Stopped() const { return nullptr != stop && stop->load(std::memory_order_relaxed); }
+
+    // Time to spend on this move in ms, or -1 when only depth/nodes/mate/stop bound the search.
+    int64_t TimeBudgetMS(chess::Color side) const {
+        if(infinite) { return -1; }
+        if(0 < movetimeMS) { return movetimeMS; }
+
+        int64_t time = side == chess::Color::WHITE ? wtimeMS : btimeMS;
+        int64_t increment = side == chess::Color::WHITE ? wincMS : bincMS;
+        if(0 >= time) { return -1; }
+
+        // spread the clock over the remaining moves, keep a reserve for overhead
+        const int64_t RESERVE_MS = 50;
+        int64_t budget = time / (0 < movesToGo ? movesToGo : 30) + increment * 3 / 4;
+        return std::max<int64_t>(1, std::min(budget, time - RESERVE_MS));
+    }
+};
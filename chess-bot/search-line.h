@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// One root move of a MultiPV search. NegaMax fills depth/score/pv,
+// MCTS fills visits/q and derives the score and depth from them.
+struct SearchLine {
+    std::string move;    // UCI
+    int score = 0;       // centipawns, side to move
+    int mateIn = 0;      // moves to mate (negative when getting mated), 0 == no mate
+    int depth = 0;
+    std::string pv;      // UCI moves separated by spaces, starting with move
+
+    uint64_t visits = 0;
+    double q = 0.0;      // mean playout result for the side to move (0..1)
+
+    // UCI "info ... multipv N ..." line for this move
+    std::string UciInfo(int multiPV, uint64_t nodes) const {
+        std::string info = "info depth " + std::to_string(depth) + " multipv " + std::to_string(multiPV);
+        if(0 != mateIn) { info += " score mate " + std::to_string(mateIn); }
+        else { info += " score cp " + std::to_string(score); }
+        info += " nodes " + std::to_string(nodes);
+        info += " pv " + (pv.empty() ? move : pv);
+        return info;
+    }
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+
+// Counters collected during a single call to Move()
+struct SearchStats {
+    uint64_t nodes = 0;
+    int depth = 0; // last completed iteration
+    int score = 0; // score of that iteration, side to move
+
+    // Eval cache //
+    uint64_t evalCacheProbes = 0;
+    uint64_t evalCacheHits = 0;
+    uint64_t evalsTimed = 0;    // misses whose Evaluate() call was timed
+    int64_t evalTimedNs = 0;    // total time of those timed calls
+
+    // Pawn hash (cumulative over the table's lifetime) //
+    uint64_t pawnProbes = 0;
+    uint64_t pawnHits = 0;
+
+    // Transposition table //
+    uint64_t ttProbes = 0;
+    uint64_t ttHits = 0;
+
+    // Mate solver //
+    uint64_t pnsNodes = 0;
+    bool pnsMate = false;       // the solver proved a forced mate
+
+    double EvalCacheHitRate() const { return 0 < evalCacheProbes ? double(evalCacheHits) / evalCacheProbes : 0.0; }
+    double TTHitRate() const { return 0 < ttProbes ? double(ttHits) / ttProbes : 0.0; }
+    double PawnHitRate() const { return 0 < pawnProbes ? double(pawnHits) / pawnProbes : 0.0; }
+
+    // Estimated evaluation time avoided by cache hits (hits * average Evaluate() cost)
+    double EvalMsSaved() const {
+        if(0 == evalsTimed) { return 0.0; }
+        return double(evalCacheHits) * (double(evalTimedNs) / evalsTimed) / 1e6;
+    }
+};
@@ -0,0 +1,78 @@
+// Live search telemetry: engines push samples into a single-producer /
+// single-consumer ring buffer that a UI (or any other observer) drains.
+// Publishing is wait-free and drops samples when the consumer falls behind,
+// so the search never waits on the observer.
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+struct TelemetrySample {
+    enum class Engine : uint8_t { NEGAMAX, MCTS };
+
+    static constexpr int PV_CHARS = 96;
+    static constexpr int TOP_CHILDREN = 5;
+
+    Engine engine = Engine::NEGAMAX;
+    bool final = false;     // last sample of this move
+    int64_t timeMS = 0;     // since the start of the move
+    uint64_t nodes = 0;     // NegaMax nodes / MCTS playouts
+    uint64_t nps = 0;       // nodes (or playouts) per second
+
+    // NegaMax //
+    int depth = 0;          // last completed iteration
+    int score = 0;          // centipawns, side to move
+    char pv[PV_CHARS] = {}; // UCI moves separated by spaces
+
+    // MCTS //
+    int numTopChildren = 0;
+    char topMoves[TOP_CHILDREN][6] = {};
+    float topShares[TOP_CHILDREN] = {}; // fraction of root visits
+
+    void SetPV(const std::string& line) {
+        size_t length = std::min(line.size(), size_t(PV_CHARS - 1));
+        std::memcpy(pv, line.data(), length);
+        pv[length] = '\0';
+    }
+};
+
+template <typename T, size_t CAPACITY>
+class SpscRing {
+    static_assert(0 == (CAPACITY & (CAPACITY - 1)), "capacity must be a power of two");
+
+public:
+    // Producer side. Returns false (and drops the sample) when full.
+    bool Push(const T& item) {
+        size_t head = this->head.load(std::memory_order_relaxed);
+        if(head - tail.load(std::memory_order_acquire) >= CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        buffer[head & (CAPACITY - 1)] = item;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool Pop(T& item) {
+        size_t tail = this->tail.load(std::memory_order_relaxed);
+        if(tail == head.load(std::memory_order_acquire)) { return false; }
+        item = buffer[tail & (CAPACITY - 1)];
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+    alignas(64) std::atomic<uint64_t> dropped = 0;
+    T buffer[CAPACITY];
+};
+
+using TelemetryRing = SpscRing<TelemetrySample, 256>;
@@ -0,0 +1,162 @@
+#include "thread-pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+thread_local WorkerState* workerState = nullptr; // set on pool workers only
+
+void PinToCore(int core) {
+#if defined(__linux__)
+    int cores = int(std::max(1u, std::thread::hardware_concurrency()));
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)core;
+#endif
+}
+} // namespace
+
+// ---------------------------------------- ThreadPool (setup) ---------------------------------------- //
+
+ThreadPool& ThreadPool::Global() {
+    static ThreadPool pool = [] {
+        int threads = std::min<int>(MAX_DEFAULT_THREADS, std::max(1u, std::thread::hardware_concurrency()));
+        if(const char* env = std::getenv("CHESS_THREADS")) { threads = std::max(1, std::atoi(env)); }
+        const char* pin = std::getenv("CHESS_PIN_CORES");
+        return ThreadPool(threads, nullptr != pin && std::string(pin) == "1");
+    }();
+    return pool;
+}
+
+ThreadPool::ThreadPool(int threads, bool pinCores) : pinCores(pinCores) { Start(threads); }
+
+ThreadPool::~ThreadPool() { Stop(); }
+
+void ThreadPool::Configure(int threads, bool pinCores) {
+    Stop();
+    this->pinCores = pinCores;
+    Start(std::max(1, threads));
+}
+
+void ThreadPool::Start(int threads) {
+    stopping = false;
+    for(int i = 0; i < threads; i++) { workers.emplace_back(&ThreadPool::WorkerLoop, this, i); }
+}
+
+// Workers finish the queue before they exit
+void ThreadPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for(std::thread& worker : workers) { worker.join(); }
+    workers.clear();
+}
+
+WorkerState& ThreadPool::LocalState() {
+    if(nullptr != workerState) { return *workerState; }
+    thread_local WorkerState state;
+    return state;
+}
+
+// ---------------------------------------- ThreadPool (tasks) ---------------------------------------- //
+
+void ThreadPool::WorkerLoop(int index) {
+    if(pinCores) { PinToCore(index); }
+    WorkerState state; // objects in it are built after pinning, so they land on the core's memory node
+    workerState = &state;
+
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workReady.wait(lock, [&] { return stopping || !queue.empty(); });
+            if(queue.empty()) { break; }
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        // Submit to start: the wake-up plus however long the job sat in the queue //
+        uint64_t waitedNS = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - job.submitted).count();
+        dispatched.fetch_add(1, std::memory_order_relaxed);
+        dispatchTotalNS.fetch_add(waitedNS, std::memory_order_relaxed);
+        uint64_t max = dispatchMaxNS.load(std::memory_order_relaxed);
+        while(waitedNS > max && !dispatchMaxNS.compare_exchange_weak(max, waitedNS, std::memory_order_relaxed)) {}
+
+        Run(job, state);
+    }
+    workerState = nullptr;
+}
+
+void ThreadPool::Run(Job& job, WorkerState& state) {
+    if(!job.group->cancelled.load(std::memory_order_relaxed)) { job.task(state); }
+    Finished(job.group);
+}
+
+void ThreadPool::Submit(Task task, TaskGroup* group) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++group->pending;
+        queue.push_back({ std::move(task), group, std::chrono::steady_clock::now() });
+    }
+    workReady.notify_one();
+    jobDone.notify_all(); // a waiting group may have been handed more work
+}
+
+bool ThreadPool::RunQueued(TaskGroup* group) {
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find_if(queue.begin(), queue.end(), [&](const Job& queued) { return queued.group == group; });
+        if(it == queue.end()) { return false; }
+        job = std::move(*it);
+        queue.erase(it);
+    }
+    Run(job, LocalState());
+    return true;
+}
+
+void ThreadPool::Finished(TaskGroup* group) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        --group->pending;
+    }
+    jobDone.notify_all();
+}
+
+DispatchStats ThreadPool::Dispatch() const {
+    DispatchStats stats;
+    stats.tasks = dispatched.load(std::memory_order_relaxed);
+    if(0 < stats.tasks) { stats.meanUS = dispatchTotalNS.load(std::memory_order_relaxed) / 1000.0 / stats.tasks; }
+    stats.maxUS = dispatchMaxNS.load(std::memory_order_relaxed) / 1000.0;
+    return stats;
+}
+
+void ThreadPool::ResetDispatch() {
+    dispatched.store(0, std::memory_order_relaxed);
+    dispatchTotalNS.store(0, std::memory_order_relaxed);
+    dispatchMaxNS.store(0, std::memory_order_relaxed);
+}
+
+// ---------------------------------------- TaskGroup ---------------------------------------- //
+
+void TaskGroup::Run(ThreadPool::Task task) { pool.Submit(std::move(task), this); }
+
+void TaskGroup::Wait() {
+    while(true) {
+        if(pool.RunQueued(this)) { continue; }
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        if(0 == pending) { return; }
+        pool.jobDone.wait(lock);
+    }
+}
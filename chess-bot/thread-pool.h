@@ -0,0 +1,138 @@
+// One process-wide pool of worker threads that every parallel part of the
+// engine schedules on: the NegaMax mate solver, batch analysis and whatever
+// search runs beside the main thread. Workers are started once and reused
+// across moves, so no move pays for thread creation or starts on cold caches.
+//
+// Size and pinning come from the environment: CHESS_THREADS (default: the
+// hardware threads, at most 12, the tournament's cores) and CHESS_PIN_CORES=1,
+// which pins worker i to core i (Linux only; elsewhere a no-op).
+//
+// Work is submitted through a TaskGroup, usually one per move: cancelling the
+// group tells its running tasks to stop and drops the ones still queued.
+// Every worker owns a WorkerState for per-thread objects that live across
+// moves (an engine and its warm tables).
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <typeindex>
+#include <vector>
+
+// Objects owned by one worker, constructed on that (pinned) thread, so their
+// memory is first touched there, and kept for the life of the pool
+class WorkerState {
+public:
+    // The worker's own T, constructed on first use and kept across tasks and moves
+    template <typename T>
+    T& Local() {
+        for(auto& [type, object] : locals) {
+            if(type == std::type_index(typeid(T))) { return *static_cast<T*>(object.get()); }
+        }
+        locals.emplace_back(std::type_index(typeid(T)), std::make_shared<T>());
+        return *static_cast<T*>(locals.back().second.get());
+    }
+
+private:
+    std::vector<std::pair<std::type_index, std::shared_ptr<void>>> locals;
+};
+
+struct DispatchStats {
+    uint64_t tasks = 0;
+    double meanUS = 0.0; // submit to start of a task
+    double maxUS = 0.0;
+};
+
+class TaskGroup;
+
+class ThreadPool {
+public:
+    using Task = std::function<void(WorkerState&)>;
+
+    static ThreadPool& Global();
+
+    // Restarts the workers; waits for the running tasks first.
+    // Their WorkerStates (and the objects in them) go with them.
+    void Configure(int threads, bool pinCores);
+    int Size() const { return int(workers.size()); }
+    bool PinnedCores() const { return pinCores; }
+
+    // State of the calling worker, or a thread-local one off the pool
+    static WorkerState& LocalState();
+
+    DispatchStats Dispatch() const;
+    void ResetDispatch();
+
+    ~ThreadPool();
+
+private:
+    friend class TaskGroup;
+
+    struct Job {
+        Task task;
+        TaskGroup* group;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    static constexpr int MAX_DEFAULT_THREADS = 12;
+
+    std::vector<std::thread> workers;
+    bool pinCores = false;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable jobDone; // TaskGroup::Wait() sleeps here
+    std::deque<Job> queue;
+    bool stopping = false;
+
+    // Dispatch latency, in nanoseconds //
+    std::atomic<uint64_t> dispatched = 0;
+    std::atomic<uint64_t> dispatchTotalNS = 0;
+    std::atomic<uint64_t> dispatchMaxNS = 0;
+
+    ThreadPool(int threads, bool pinCores);
+    void Start(int threads);
+    void Stop();
+    void WorkerLoop(int index);
+    void Run(Job& job, WorkerState& state);
+    void Submit(Task task, TaskGroup* group);
+    bool RunQueued(TaskGroup* group); // one queued job of the group on the calling thread
+    void Finished(TaskGroup* group);
+};
+
+// The tasks of one move (or one batch run). Destroying the group cancels
+// and waits for it, so tasks may capture locals of the scope that owns it.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool = ThreadPool::Global()) : pool(pool) {}
+    ~TaskGroup() {
+        Cancel();
+        Wait();
+    }
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void Run(ThreadPool::Task task);
+
+    // Running tasks see Cancelled(); queued ones never start
+    void Cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    const std::atomic<bool>& Cancelled() const { return cancelled; }
+
+    // Until every task has finished or been dropped. Queued tasks of this group
+    // run on the waiting thread, so waiting from inside a worker can't deadlock.
+    void Wait();
+
+    // Reuse the group for the next move once Wait() returned
+    void Reset() { cancelled.store(false, std::memory_order_relaxed); }
+
+private:
+    friend class ThreadPool;
+    ThreadPool& pool;
+    std::atomic<bool> cancelled = false;
+    int pending = 0; // guarded by the pool's mutex
+};
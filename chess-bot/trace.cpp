@@ -0,0 +1,217 @@
+#include "trace.h"
+
+#if defined(CHESS_TRACE)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// Chrome trace events kept per thread and move; the profile keeps counting past it
+const size_t MAX_EVENTS = size_t(1) << 20;
+
+struct Event {
+    const char* name;
+    uint64_t start;    // ns since the start of the move
+    uint64_t duration; // ns
+};
+
+struct Stat {
+    const char* name;
+    uint64_t calls = 0;
+    uint64_t totalNs = 0;
+    uint64_t selfNs = 0;
+};
+
+struct Counter {
+    const char* name;
+    int64_t value = 0;
+};
+
+struct ThreadBuffer {
+    int id = 0;
+    bool inUse = true;
+    Trace::Scope* current = nullptr; // innermost open scope
+    std::vector<Event> events;
+    std::vector<Stat> stats;         // a handful of names: a linear scan beats hashing
+    std::vector<Counter> counters;
+    uint64_t droppedEvents = 0;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry; // never shrinks; exited threads' buffers are reused
+std::atomic<uint64_t> moveStart = 0;
+
+uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Releases the buffer for reuse when its thread exits (search helper threads come and go every move)
+struct BufferOwner {
+    ThreadBuffer* buffer = nullptr;
+    ~BufferOwner() {
+        if(nullptr == buffer) { return; }
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffer->inUse = false;
+        buffer->current = nullptr;
+    }
+};
+
+ThreadBuffer& Local() {
+    thread_local BufferOwner owner;
+    if(nullptr != owner.buffer) { return *owner.buffer; }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if(0 == moveStart.load()) { moveStart = Now(); }
+    for(auto& buffer : registry) {
+        if(!buffer->inUse) {
+            buffer->inUse = true;
+            owner.buffer = buffer.get();
+            return *owner.buffer;
+        }
+    }
+    registry.push_back(std::make_unique<ThreadBuffer>());
+    registry.back()->id = int(registry.size());
+    registry.back()->events.reserve(4096);
+    owner.buffer = registry.back().get();
+    return *owner.buffer;
+}
+
+} // namespace
+
+Trace::Scope::Scope(const char* name) : name(name) {
+    ThreadBuffer& buffer = Local();
+    parent = buffer.current;
+    buffer.current = this;
+    start = Now();
+}
+
+Trace::Scope::~Scope() {
+    uint64_t end = Now();
+    uint64_t duration = end - start;
+    ThreadBuffer& buffer = Local();
+    buffer.current = parent;
+    if(nullptr != parent) { parent->childNs += duration; }
+
+    auto stat = std::find_if(buffer.stats.begin(), buffer.stats.end(), [&](const Stat& s) { return s.name == name; });
+    if(buffer.stats.end() == stat) {
+        buffer.stats.push_back(Stat{ name });
+        stat = buffer.stats.end() - 1;
+    }
+    stat->calls++;
+    stat->totalNs += duration;
+    stat->selfNs += duration - std::min(duration, childNs);
+
+    uint64_t origin = moveStart.load(std::memory_order_relaxed);
+    if(buffer.events.size() < MAX_EVENTS) { buffer.events.push_back(Event{ name, start > origin ? start - origin : 0, duration }); }
+    else { buffer.droppedEvents++; }
+}
+
+void Trace::Count(const char* name, int64_t n) {
+    ThreadBuffer& buffer = Local();
+    for(Counter& counter : buffer.counters) {
+        if(counter.name == name) {
+            counter.value += n;
+            return;
+        }
+    }
+    buffer.counters.push_back(Counter{ name, n });
+}
+
+bool Trace::WriteChromeTrace(const std::string& path) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if(nullptr == file) { return false; }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    uint64_t last = 0;
+    std::map<std::string, int64_t> counters;
+    for(const auto& buffer : registry) {
+        for(const Event& event : buffer->events) {
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", event.name, buffer->id, event.start / 1000.0, event.duration / 1000.0);
+            first = false;
+            last = std::max(last, event.start + event.duration);
+        }
+        for(const Counter& counter : buffer->counters) { counters[counter.name] += counter.value; }
+    }
+    // Counters as one sample at the end of the move //
+    for(const auto& [name, value] : counters) {
+        std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"args\":{\"value\":%lld}}",
+            first ? "" : ",\n", name.c_str(), last / 1000.0, static_cast<long long>(value));
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+    return 0 == std::fclose(file);
+}
+
+void Trace::PrintProfile(std::ostream& out) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+
+    // The same name can be a different literal in every translation unit: merge by text //
+    std::map<std::string, Stat> stats;
+    std::map<std::string, int64_t> counters;
+    uint64_t selfTotal = 0;
+    uint64_t dropped = 0;
+    for(const auto& buffer : registry) {
+        for(const Stat& stat : buffer->stats) {
+            Stat& merged = stats.try_emplace(stat.name, Stat{ stat.name }).first->second;
+            merged.calls += stat.calls;
+            merged.totalNs += stat.totalNs;
+            merged.selfNs += stat.selfNs;
+            selfTotal += stat.selfNs;
+        }
+        for(const Counter& counter : buffer->counters) { counters[counter.name] += counter.value; }
+        dropped += buffer->droppedEvents;
+    }
+
+    std::vector<Stat> sorted;
+    for(const auto& [name, stat] : stats) { sorted.push_back(stat); }
+    std::sort(sorted.begin(), sorted.end(), [](const Stat& a, const Stat& b) { return a.selfNs > b.selfNs; });
+
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-28s %12s %11s %11s %7s %9s\n", "scope", "calls", "total ms", "self ms", "self %", "ns/call");
+    out << line;
+    for(const Stat& stat : sorted) {
+        std::snprintf(line, sizeof(line), "%-28s %12llu %11.2f %11.2f %6.1f%% %9.0f\n",
+            stat.name, static_cast<unsigned long long>(stat.calls), stat.totalNs / 1e6, stat.selfNs / 1e6,
+            0 < selfTotal ? 100.0 * stat.selfNs / selfTotal : 0.0, double(stat.totalNs) / std::max<uint64_t>(1, stat.calls));
+        out << line;
+    }
+    for(const auto& [name, value] : counters) {
+        std::snprintf(line, sizeof(line), "%-28s %12lld\n", name.c_str(), static_cast<long long>(value));
+        out << line;
+    }
+    if(0 < dropped) { out << "(" << dropped << " trace events past the per-thread limit were not recorded)\n"; }
+}
+
+void Trace::Reset() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for(auto& buffer : registry) {
+        buffer->events.clear();
+        buffer->stats.clear();
+        buffer->counters.clear();
+        buffer->droppedEvents = 0;
+    }
+    moveStart = Now();
+}
+
+void Trace::EndMove() {
+    PrintProfile(std::cerr);
+    const char* path = std::getenv("CHESS_TRACE_FILE");
+    if(nullptr != path && '\0' != path[0] && !WriteChromeTrace(path)) {
+        std::cerr << "could not write trace to " << path << std::endl;
+    }
+    Reset();
+}
+
+#endif // CHESS_TRACE
@@ -0,0 +1,60 @@
+// Hot-path tracing: scoped timers and counters for a per-function cost breakdown
+// of a move (move generation, make/unmake, evaluation, capture ordering, the
+// MCTS phases) without a sampling profiler.
+//
+// Compiled in only with -DCHESS_TRACE (CMake option CHESS_TRACE); otherwise the
+// macros expand to nothing and the search is unchanged. When enabled, every
+// thread records into its own buffer, so tracing takes no locks. After each
+// move ChessSimulator prints a flat profile to stderr and, when CHESS_TRACE_FILE
+// is set, writes that move's Chrome trace_event JSON (chrome://tracing, Perfetto).
+//
+// A scope costs two clock reads (~40 ns), which dominates very small functions
+// such as makeMove: compare those by call count rather than by time.
+
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(CHESS_TRACE)
+#define CHESS_TRACE_CONCAT_(a, b) a##b
+#define CHESS_TRACE_CONCAT(a, b) CHESS_TRACE_CONCAT_(a, b)
+// Times the rest of the enclosing block
+#define CHESS_TRACE_SCOPE(name) Trace::Scope CHESS_TRACE_CONCAT(traceScope, __LINE__)(name)
+// Times one statement
+#define CHESS_TRACE_CALL(name, statement) do { CHESS_TRACE_SCOPE(name); statement; } while(false)
+#define CHESS_TRACE_COUNT(name, n) Trace::Count(name, n)
+#define CHESS_TRACE_END_MOVE() Trace::EndMove()
+#else
+#define CHESS_TRACE_SCOPE(name) ((void)0)
+#define CHESS_TRACE_CALL(name, statement) do { statement; } while(false)
+#define CHESS_TRACE_COUNT(name, n) ((void)0)
+#define CHESS_TRACE_END_MOVE() ((void)0)
+#endif
+
+class Trace {
+public:
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        uint64_t start;
+        uint64_t childNs = 0; // time spent in nested scopes, for self time
+        Scope* parent;
+    };
+
+    static void Count(const char* name, int64_t n);
+
+    // The reports read every thread's buffer: call them while the traced threads are idle
+    static bool WriteChromeTrace(const std::string& path);
+    static void PrintProfile(std::ostream& out);
+    static void Reset();
+
+    // Profile to stderr, Chrome trace to CHESS_TRACE_FILE, then Reset()
+    static void EndMove();
+};
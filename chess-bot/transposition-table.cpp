@@ -0,0 +1,84 @@
+#include "transposition-table.h"
+#include "hash-scheme.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+void TranspositionTable::Reserve() {
+    if(nullptr != slots) { return; }
+    size_t bytes = 0 != requestedBytes ? requestedBytes : MemoryBudget::Global().Share(MemoryComponent::TT);
+    block = MemoryBudget::Global().Allocate(MemoryComponent::TT, bytes);
+    slots = block.As<Slot>();
+    mask = block.Size() / sizeof(Slot) - 1;
+}
+
+bool TranspositionTable::OpenFile(const std::string& path, size_t bytes, uint64_t evalId) {
+    size_t slotCount = std::bit_floor(std::max<size_t>(1, bytes / sizeof(Slot)));
+    MemoryBlock mapped = MemoryBudget::Global().MapFile(MemoryComponent::TT, path, HEADER_BYTES + slotCount * sizeof(Slot), true);
+    if(nullptr == mapped.As<void>()) { return false; }
+
+    block = std::move(mapped);
+    header = block.As<FileHeader>();
+    slots = reinterpret_cast<Slot*>(block.As<char>() + HEADER_BYTES);
+    mask = slotCount - 1;
+
+    // Anything unexpected (new file, other version, other hashing, other size, other evaluation) starts over //
+    bool valid = 0 == std::memcmp(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC))
+        && FILE_VERSION == header->version
+        && sizeof(Slot) == header->slotSize
+        && HashSchemeFingerprint() == header->hashScheme
+        && slotCount == header->slotCount
+        && evalId == header->evalId;
+    this->evalId = evalId;
+    if(valid) { return true; }
+
+    // Invalidate first, so a crash during the rebuild is caught next time //
+    header->magic[0] = '\0';
+    std::memset(slots, 0, slotCount * sizeof(Slot));
+    header->version = FILE_VERSION;
+    header->slotSize = sizeof(Slot);
+    header->hashScheme = HashSchemeFingerprint();
+    header->slotCount = slotCount;
+    header->evalId = evalId;
+    std::memcpy(header->magic, FILE_MAGIC, sizeof(FILE_MAGIC));
+    return true;
+}
+
+bool TranspositionTable::Probe(uint64_t key, Entry& entry) const {
+    const Slot& slot = slots[key & mask];
+    uint64_t data = slot.data;
+    if((slot.check ^ data) != key) { return false; } // other position, empty, or torn
+
+    entry = std::bit_cast<Entry>(data);
+    return NONE != entry.bound;
+}
+
+void TranspositionTable::Store(uint64_t key, int score, uint16_t move, int depth, Bound bound) {
+    Slot& slot = slots[key & mask];
+    Entry old;
+    bool samePosition = Probe(key, old);
+    if(samePosition && depth < old.depth && EXACT != bound) { return; }
+    if(chess::Move::NO_MOVE == move && samePosition) { move = old.move; } // keep the old best move
+
+    Entry entry;
+    entry.score = score;
+    entry.move = move;
+    entry.depth = static_cast<int8_t>(depth);
+    entry.bound = bound;
+
+    uint64_t data = std::bit_cast<uint64_t>(entry);
+    slot.data = data;
+    slot.check = key ^ data;
+}
+
+void TranspositionTable::Clear() {
+    if(nullptr == slots) { return; }
+    std::memset(slots, 0, (mask + 1) * sizeof(Slot));
+}
+
+void TranspositionTable::SetEvaluation(uint64_t id) {
+    if(id == evalId) { return; }
+    Clear();
+    evalId = id;
+    if(nullptr != header) { header->evalId = id; }
+}
@@ -0,0 +1,85 @@
+// Transposition table for NegaMax
+// https://www.chessprogramming.org/Transposition_Table
+// Direct-mapped, sized from the memory budget. An entry stores the search
+// result of a position: score, bound type, depth and best move.
+//
+// The memory is taken on the first Reserve() (the start of a search), not on
+// construction, so engines built before the budget is configured get their
+// proper share and a table replaced by a file is never allocated.
+//
+// The table can live in a memory-mapped file (OpenFile()) so that a fresh
+// process per move still starts with the previous searches. Only one engine
+// per process should open a given file (ChessSimulator::SetTTFile()).
+// Each slot stores key ^ data next to data, so an entry torn by a crash
+// or by a concurrent writer fails the check and reads as a miss
+// (https://www.chessprogramming.org/Shared_Hash_Table#Lockless).
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include "chess.hpp"
+#include "memory-budget.h"
+
+class TranspositionTable {
+public:
+    enum Bound : uint8_t { NONE, UPPER, LOWER, EXACT };
+
+    struct Entry {
+        int32_t score = 0;
+        uint16_t move = chess::Move::NO_MOVE;
+        int8_t depth = 0;
+        uint8_t bound = NONE;
+    };
+    static_assert(8 == sizeof(Entry), "an entry packs into one 64-bit word");
+
+    // bytes == 0: the budget's share at the time of Reserve()
+    explicit TranspositionTable(size_t bytes = 0) : requestedBytes(bytes) {}
+
+    // Allocate the in-memory table unless there already is one (or a file)
+    void Reserve();
+
+    // Back the table with a file (created or resized as needed). Its entries are
+    // kept only if they were searched with the evaluation `evalId` (see SetEvaluation()).
+    // Keeps the current table and returns false when the file can't be mapped.
+    bool OpenFile(const std::string& path, size_t bytes, uint64_t evalId);
+    bool FileBacked() const { return nullptr != header; }
+
+    bool Probe(uint64_t key, Entry& entry) const;
+
+    // Keeps a deeper result for the same position, otherwise always replaces
+    void Store(uint64_t key, int score, uint16_t move, int depth, Bound bound);
+
+    void Clear();
+
+    // Scores depend on the evaluation (EvalFingerprint() or a network's id):
+    // switching to a different one clears the table
+    void SetEvaluation(uint64_t evalId);
+
+    size_t Size() const { return block.Size(); }
+
+private:
+    struct Slot {
+        uint64_t check; // key ^ data
+        uint64_t data;  // Entry bits
+    };
+
+    // First page of a table file
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t slotSize;
+        uint64_t hashScheme; // fingerprint of the Zobrist keys
+        uint64_t slotCount;
+        uint64_t evalId;
+    };
+    static constexpr char FILE_MAGIC[8] = "CHESSTT";
+    static constexpr uint32_t FILE_VERSION = 1;
+    static constexpr size_t HEADER_BYTES = 4096;
+
+    size_t requestedBytes;
+    MemoryBlock block;
+    FileHeader* header = nullptr; // nullptr == memory-backed
+    Slot* slots = nullptr;        // nullptr == not reserved yet
+    uint64_t mask = 0;
+    uint64_t evalId = 0;
+};
@@ -0,0 +1,44 @@
+#include "tree-recorder.h"
+
+bool TreeRecorder::Open(const std::string& path) {
+    Close();
+    file = std::fopen(path.c_str(), "wb");
+    if(nullptr == file) { return false; }
+
+    buffer.resize(BUFFER_BYTES);
+    used = 0;
+    records = 0;
+    moves = 0;
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.recordSize = RECORD_SIZE;
+    std::fwrite(&header, sizeof(header), 1, file);
+    return true;
+}
+
+void TreeRecorder::Close() {
+    if(nullptr == file) { return; }
+    Flush();
+    std::fclose(file);
+    file = nullptr;
+    buffer.clear();
+    buffer.shrink_to_fit();
+}
+
+void TreeRecorder::BeginMove(uint64_t rootHash) {
+    SearchRecord record = {};
+    record.type = MOVE;
+    record.hash = rootHash;
+    record.nodes = ++moves;
+    record.cutoffIndex = NO_INDEX;
+    Write(record);
+}
+
+void TreeRecorder::Flush() {
+    if(nullptr == file || 0 == used) { return; }
+    std::fwrite(buffer.data(), 1, used, file);
+    std::fflush(file); // a crashed or killed process still leaves every finished move on disk
+    used = 0;
+}
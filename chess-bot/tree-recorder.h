@@ -0,0 +1,103 @@
+// Search-tree recorder: streams the nodes a search visited to a compact binary
+// file, so a bad move can be taken apart afterwards with chesstree (cutoff
+// positions, wasted subtrees, MCTS visit spread).
+//
+// Records are fixed 32-byte structs appended to a 1 MB buffer that is written
+// out when full, so recording costs a memcpy per node. NegaMax writes a node
+// when its search returns (post-order: children before their parent, linked by
+// ply and child index). MCTS writes its whole tree at the end of a move, parents
+// first, each node pointing at its parent's record.
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class TreeRecorder {
+public:
+    enum RecordType : uint8_t {
+        MOVE,       // start of a move: hash of the root position
+        NEGAMAX,    // interior NegaMax node
+        QUIESCENCE, // NegaMax horizon node, resolved by quiescence search
+        TT_CUTOFF,  // NegaMax node answered by the transposition table
+        ROOT,       // NegaMax root at the end of an iteration
+        MCTS_NODE
+    };
+    static constexpr uint8_t NO_INDEX = 255;
+
+    struct SearchRecord {
+        uint8_t type;
+        uint8_t ply;
+        int8_t depth;
+        uint8_t childIndex;  // index of the move into this node in the parent's move list
+        uint8_t cutoffIndex; // move that failed high, else the one that raised alpha, else NO_INDEX
+        uint8_t moveCount;
+        uint16_t move;       // move into this node (chess::Move encoding)
+        uint64_t hash;
+        int32_t alpha;       // window on entry
+        int32_t beta;
+        int32_t score;
+        uint32_t nodes;      // NegaMax nodes in this subtree, including this one
+    };
+    static_assert(32 == sizeof(SearchRecord), "records are written raw");
+
+    struct MCTSRecord {
+        uint8_t type;
+        uint8_t ply;
+        uint16_t children;
+        uint16_t move;
+        uint16_t unused;
+        uint64_t hash;
+        uint32_t parent;     // record index within this move, the root points at itself
+        uint32_t visits;     // playouts through the move from the parent (the root: all of its playouts)
+        double wins;         // their wins for the side that made the move
+    };
+    static_assert(32 == sizeof(MCTSRecord), "records are written raw");
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+    };
+    static constexpr char MAGIC[8] = "CHESSTR";
+    static constexpr uint32_t VERSION = 1;
+
+    TreeRecorder() = default;
+    TreeRecorder(const TreeRecorder&) = delete;
+    TreeRecorder& operator=(const TreeRecorder&) = delete;
+    ~TreeRecorder() { Close(); }
+
+    // Truncates the file; false if it can't be created
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return nullptr != file; }
+
+    void BeginMove(uint64_t rootHash);
+
+    template <typename Record>
+    void Write(const Record& record) {
+        static_assert(RECORD_SIZE == sizeof(Record));
+        if(nullptr == file) { return; }
+        if(buffer.size() - used < RECORD_SIZE) { Flush(); }
+        std::memcpy(buffer.data() + used, &record, RECORD_SIZE);
+        used += RECORD_SIZE;
+        ++records;
+    }
+
+    // Hands the buffered records to the OS (also done when the buffer fills up)
+    void Flush();
+
+    uint64_t Records() const { return records; }
+
+private:
+    static constexpr size_t RECORD_SIZE = 32;
+    static constexpr size_t BUFFER_BYTES = size_t(1) << 20;
+
+    FILE* file = nullptr;
+    std::vector<char> buffer;
+    size_t used = 0;
+    uint64_t records = 0;
+    uint32_t moves = 0;
+};
@@ -0,0 +1,52 @@
+#include "analyze.h"
+#include "mcts.h"
+#include "memory-budget.h"
+#include "negamax.h"
+#include "trace.h"
+#include "tree-recorder.h"
+#include <iostream>
+#include <memory>
+
+int Analyze(const std::string &fen, std::ostream &out,
+            const AnalyzeOptions &options) {
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.nodes = options.nodes;
+    limits.movetimeMS = options.movetimeMS;
+    limits.multiPV = options.multiPV;
+
+    TreeRecorder recorder;
+    if (!options.record.empty() && !recorder.Open(options.record))
+        std::cerr << "could not create " << options.record << std::endl;
+
+    std::string move;
+    std::vector<SearchLine> lines;
+    uint64_t nodes = 0;
+    // engines stay alive until the memory report below
+    std::unique_ptr<MCTS> mcts;
+    std::unique_ptr<NegaMax> negamax;
+    if (options.mcts) {
+        mcts = std::make_unique<MCTS>();
+        mcts->SetRecorder(recorder.IsOpen() ? &recorder : nullptr);
+        move = mcts->Move(fen, limits);
+        lines = mcts->Lines();
+        nodes = mcts->Playouts();
+    } else {
+        negamax = std::make_unique<NegaMax>();
+        negamax->SetRecorder(recorder.IsOpen() ? &recorder : nullptr);
+        move = negamax->Move(fen, limits);
+        lines = negamax->Lines();
+        nodes = negamax->Stats().nodes;
+    }
+    CHESS_TRACE_END_MOVE(); // profile to stderr in CHESS_TRACE builds
+
+    for (size_t i = 0; i < lines.size(); i++)
+        out << lines[i].UciInfo(int(i) + 1, nodes) << "\n";
+    for (const MemoryUsage &usage : MemoryBudget::Global().Usage())
+        if (usage.bytes > 0)
+            out << "info string memory " << usage.component << " "
+                << (usage.bytes >> 20) << " MB"
+                << (usage.hugePageBytes > 0 ? " (huge pages)" : "") << "\n";
+    out << "bestmove " << (move.empty() ? "(none)" : move) << std::endl;
+    return 0;
+}
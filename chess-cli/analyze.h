@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+struct AnalyzeOptions {
+    int multiPV = 1;
+    bool mcts = false;   // MCTS instead of NegaMax
+    int depth = 0;       // 0 == no depth limit
+    uint64_t nodes = 0;  // 0 == no node limit
+    int movetimeMS = 0;  // 0 == no time limit
+    std::string record;  // tree recorder file ("" == off)
+};
+
+// Searches one position and writes one UCI "info ... multipv N ..." line per
+// requested line, best first, followed by "bestmove".
+int Analyze(const std::string &fen, std::ostream &out,
+            const AnalyzeOptions &options);
@@ -0,0 +1,118 @@
+#include "batch.h"
+#include "memory-budget.h"
+#include "negamax.h"
+#include "thread-pool.h"
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace {
+struct BatchState {
+    std::mutex mutex;
+    std::condition_variable inputReady;
+    std::condition_variable spaceFree;
+
+    std::queue<std::pair<uint64_t, std::string>> input;
+    std::map<uint64_t, std::string> finished; // results waiting for their turn
+    uint64_t nextToWrite = 0;
+    bool inputDone = false;
+};
+} // namespace
+
+int RunBatch(std::istream &in, std::ostream &out,
+             const BatchOptions &options) {
+    BatchState state;
+    // bounds how far reading may run ahead of writing (memory stays flat)
+    const uint64_t window = uint64_t(options.threads) * 4;
+
+    // one engine per pool worker, kept with the worker (and its warm tables)
+    auto worker = [&](WorkerState &thread) {
+        NegaMax *engine = &thread.Local<NegaMax>();
+        SearchLimits limits;
+        limits.depth = options.depth;
+        limits.nodes = options.nodes;
+        limits.movetimeMS = options.movetimeMS;
+
+        while (true) {
+            std::pair<uint64_t, std::string> job;
+            {
+                std::unique_lock<std::mutex> lock(state.mutex);
+                state.inputReady.wait(
+                    lock, [&] { return !state.input.empty() || state.inputDone; });
+                if (state.input.empty())
+                    return;
+                job = std::move(state.input.front());
+                state.input.pop();
+            }
+
+            // a fixed-node result must not depend on which positions the
+            // worker searched before
+            if (0 < options.nodes)
+                engine->ClearTables();
+            std::string move = engine->Move(job.second, limits);
+            const SearchStats &stats = engine->Stats();
+            std::string line = job.second + "\t" +
+                               (move.empty() ? "(none)" : move) + "\t" +
+                               std::to_string(stats.score) + "\t" +
+                               std::to_string(stats.nodes) + "\n";
+
+            // write every result that is now next in input order
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.finished.emplace(job.first, std::move(line));
+            for (auto it = state.finished.begin();
+                 it != state.finished.end() && it->first == state.nextToWrite;
+                 it = state.finished.erase(it)) {
+                out << it->second;
+                state.nextToWrite++;
+            }
+            out.flush();
+            state.spaceFree.notify_one();
+        }
+    };
+
+    MemoryBudget::Global().SetConcurrency(options.threads);
+    // each engine holds a worker for the whole run; as many again stay free for
+    // the helper tasks the engines start (NegaMax's mate solver)
+    ThreadPool &pool = ThreadPool::Global();
+    if (pool.Size() < 2 * options.threads)
+        pool.Configure(2 * options.threads, pool.PinnedCores());
+    pool.ResetDispatch();
+    TaskGroup workers(pool);
+    for (int i = 0; i < options.threads; i++)
+        workers.Run(worker);
+
+    // stream the input
+    std::string fen;
+    uint64_t index = 0;
+    while (std::getline(in, fen)) {
+        if (!fen.empty() && fen.back() == '\r')
+            fen.pop_back();
+        if (fen.empty())
+            continue;
+
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.spaceFree.wait(lock,
+                             [&] { return index - state.nextToWrite < window; });
+        state.input.emplace(index++, std::move(fen));
+        state.inputReady.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.inputDone = true;
+    }
+    state.inputReady.notify_all();
+    workers.Wait();
+
+    DispatchStats dispatch = pool.Dispatch();
+    std::fprintf(stderr,
+                 "pool: %d threads, %llu tasks, dispatch mean %.1fus max "
+                 "%.1fus\n",
+                 pool.Size(), (unsigned long long)dispatch.tasks,
+                 dispatch.meanUS, dispatch.maxUS);
+    return 0;
+}
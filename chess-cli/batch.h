@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+struct BatchOptions {
+    int threads = 1;
+    int depth = 0;       // 0 == no depth limit
+    uint64_t nodes = 0;  // 0 == no node limit
+    int movetimeMS = 0;  // 0 == no time limit
+};
+
+// Streams one FEN per line from `in`, analyzes them on the engine's thread
+// pool (`threads` engines, each on its own worker, plus as many workers for
+// their mate solvers; the pool grows if needed) and writes
+// "fen\tmove\tscore\tnodes" lines to `out` in input order.
+int RunBatch(std::istream &in, std::ostream &out, const BatchOptions &options);
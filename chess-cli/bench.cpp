@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "chess.hpp"
+#include "evaluation.h"
+#include "negamax.h"
+#include "nnue.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// random games from the start position, so both evals see the same positions
+std::vector<std::vector<chess::Move>> RandomGames(int numGames, int maxPlies) {
+    std::mt19937 gen(12345);
+    std::vector<std::vector<chess::Move>> games;
+    for (int g = 0; g < numGames; g++) {
+        chess::Board board;
+        std::vector<chess::Move> game;
+        for (int ply = 0; ply < maxPlies; ply++) {
+            chess::Movelist moves;
+            chess::movegen::legalmoves(moves, board);
+            if (moves.empty())
+                break;
+            auto move = moves[gen() % moves.size()];
+            board.makeMove(move);
+            game.push_back(move);
+        }
+        games.push_back(game);
+    }
+    return games;
+}
+
+double Seconds(Clock::time_point since) {
+    return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+template <typename EvalFn>
+void Report(const char *name, const std::vector<std::vector<chess::Move>> &games,
+            EvalFn evalGame) {
+    uint64_t evals = 0;
+    int64_t checksum = 0;
+    auto start = Clock::now();
+    do {
+        for (auto &game : games)
+            evals += evalGame(game, checksum);
+    } while (Seconds(start) < 1.0);
+    std::cout << name << ": " << uint64_t(evals / Seconds(start))
+              << " evals/s (checksum " << checksum << ")" << std::endl;
+}
+} // namespace
+
+int BenchEval(const std::string &networkPath) {
+    auto network = NNUENetwork::Load(networkPath);
+    if (!network) {
+        std::cerr << "Failed to load NNUE network: " << networkPath << std::endl;
+        return 1;
+    }
+
+    auto games = RandomGames(64, 80);
+
+    // evaluation throughput
+    Eval eval;
+    Report("PST eval", games, [&](auto &game, int64_t &checksum) {
+        chess::Board board;
+        for (auto move : game) {
+            board.makeMove(move);
+            checksum += eval.Evaluate(board);
+        }
+        return game.size();
+    });
+
+    NNUE nnue;
+    nnue.SetNetwork(network.get());
+    Report("NNUE (full refresh)", games, [&](auto &game, int64_t &checksum) {
+        chess::Board board;
+        for (auto move : game) {
+            board.makeMove(move);
+            nnue.Refresh(board);
+            checksum += nnue.Evaluate(board);
+        }
+        return game.size();
+    });
+    Report("NNUE (incremental)", games, [&](auto &game, int64_t &checksum) {
+        chess::Board board;
+        nnue.Refresh(board);
+        for (auto move : game) {
+            nnue.Push(board, move);
+            board.makeMove(move);
+            checksum += nnue.Evaluate(board);
+        }
+        return game.size();
+    });
+
+    // search speed with each backend (strength per time: see chessmatch)
+    const char *fens[] = {
+        chess::constants::STARTPOS,
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    };
+    for (const NNUENetwork *backend : {(const NNUENetwork *)nullptr,
+                                       (const NNUENetwork *)network.get()}) {
+        NegaMax negamax;
+        negamax.SetNetwork(backend);
+        uint64_t nodes = 0;
+        auto start = Clock::now();
+        for (auto fen : fens) {
+            negamax.Move(fen, SearchLimits::MoveTime(1000));
+            nodes += negamax.Stats().nodes;
+        }
+        std::cout << (backend ? "NegaMax NNUE: " : "NegaMax PST: ")
+                  << uint64_t(nodes / Seconds(start)) << " nodes/s" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <string>
+
+// Evaluations per second of the PST eval vs the NNUE eval (full refresh and
+// incremental), plus search speed of NegaMax with each backend.
+int BenchEval(const std::string &networkPath);
@@ -1,10 +1,136 @@
+#include "analyze.h"
+#include "batch.h"
+#include "bench.h"
 #include "chess-simulator.h"
 #include "chess.hpp"
+#include "memory-budget.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
 #include <string>
+#include <thread>
+
+void PrintUsage() {
+    std::cerr << "usage: chesscli [--tt-file f] [--tt-mb n] [--book f]\n"
+                 "                                     read one FEN from stdin, "
+                 "print the move\n"
+                 "                                     (--tt-file keeps the "
+                 "search table on disk between runs)\n"
+                 "       chesscli --bench-eval <net>   benchmark the PST and "
+                 "NNUE evaluations\n"
+                 "       chesscli --batch [file|-] [--threads n] [--depth d] "
+                 "[--nodes n] [--movetime ms]\n"
+                 "                                     analyze one FEN per line, "
+                 "print fen<TAB>move<TAB>score<TAB>nodes\n"
+                 "       chesscli --analyze [--multipv n] [--mcts] [--depth d] "
+                 "[--nodes n] [--movetime ms]\n"
+                 "                 [--record f]        read one FEN from stdin, "
+                 "print UCI multipv info lines\n"
+                 "                                     (--record writes the "
+                 "searched tree for chesstree)\n"
+                 "                                     (CHESS_MEMORY_MB sets the "
+                 "memory budget)\n";
+}
+
+int main(int argc, char *argv[]) {
+    // chesscli --bench-eval <network.nnue>
+    if (argc > 2 && std::string(argv[1]) == "--bench-eval")
+        return BenchEval(argv[2]);
+
+    // chesscli --batch [file] [limits]
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        BatchOptions options;
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+        std::string path = "-";
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--threads" && hasValue)
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--depth" && hasValue)
+                options.depth = std::stoi(argv[++i]);
+            else if (arg == "--nodes" && hasValue)
+                options.nodes = std::stoull(argv[++i]);
+            else if (arg == "--movetime" && hasValue)
+                options.movetimeMS = std::stoi(argv[++i]);
+            else if (arg[0] != '-' || arg == "-")
+                path = arg;
+            else {
+                PrintUsage();
+                return 1;
+            }
+        }
+        if (!options.depth && !options.nodes && !options.movetimeMS) {
+            std::cerr << "--batch needs at least one of --depth, --nodes or "
+                         "--movetime"
+                      << std::endl;
+            return 1;
+        }
+
+        if (path == "-")
+            return RunBatch(std::cin, std::cout, options);
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Failed to open " << path << std::endl;
+            return 1;
+        }
+        return RunBatch(file, std::cout, options);
+    }
+
+    // chesscli --analyze [options] < fen
+    if (argc > 1 && std::string(argv[1]) == "--analyze") {
+        AnalyzeOptions options;
+        for (int i = 2; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--multipv" && hasValue)
+                options.multiPV = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--mcts")
+                options.mcts = true;
+            else if (arg == "--depth" && hasValue)
+                options.depth = std::stoi(argv[++i]);
+            else if (arg == "--nodes" && hasValue)
+                options.nodes = std::stoull(argv[++i]);
+            else if (arg == "--movetime" && hasValue)
+                options.movetimeMS = std::stoi(argv[++i]);
+            else if (arg == "--record" && hasValue)
+                options.record = argv[++i];
+            else {
+                PrintUsage();
+                return 1;
+            }
+        }
+        if (!options.depth && !options.nodes && !options.movetimeMS)
+            options.movetimeMS = 1000;
+
+        std::string fen;
+        getline(std::cin, fen);
+        return Analyze(fen, std::cout, options);
+    }
+
+    // chesscli [--tt-file path] [--tt-mb n] [--book path] < fen
+    std::string ttFile;
+    size_t ttBytes = MemoryBudget::Global().Share(MemoryComponent::TT);
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--tt-file" && hasValue)
+            ttFile = argv[++i];
+        else if (arg == "--tt-mb" && hasValue)
+            ttBytes = size_t(std::max(1, std::stoi(argv[++i]))) << 20;
+        else if (arg == "--book" && hasValue) {
+            if (!ChessSimulator::SetBookFile(argv[++i]))
+                std::cerr << "Failed to open book " << argv[i] << std::endl;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (!ttFile.empty() && !ChessSimulator::SetTTFile(ttFile, ttBytes))
+        std::cerr << "Failed to map " << ttFile << ", using memory" << std::endl;
 
-int main() {
     std::string fen;
     getline(std::cin, fen);
     auto move = ChessSimulator::Move(fen);
     std::cout << move << std::endl;
-}
\ No newline at end of file
+}
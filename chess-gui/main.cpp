@@ -29,36 +29,262 @@ EM_JS(int, canvas_get_height, (), { return canvas.height; });
 
 #include "PieceSvg.h"
 #include "magic_enum/magic_enum.hpp"
+#include <atomic>
+#include <cfloat>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <future>
 #include <map>
+#include <optional>
 
 enum class SimulationState {
   PAUSED,
   RUNNING,
 };
 
+// engine move and how long the engine call took, timed on the worker so the
+// frame that picks it up doesn't add its own delay
+struct SearchResult {
+  std::string move;
+  std::chrono::nanoseconds elapsed;
+};
+
+// search running on a worker thread so the render loop never blocks
+struct PendingSearch {
+  std::future<SearchResult> result;
+  std::chrono::high_resolution_clock::time_point startTime;
+  std::string turn;
+  bool discard = false; // cancelled by Pause/Reset; drop the result
+};
+
 // ui settings
+const int MOVE_TIME_LIMIT_MS = 10000; // the tournament's per-move limit
 auto simulationState = SimulationState::PAUSED;
 std::chrono::nanoseconds timeSpentOnMoves = std::chrono::nanoseconds::zero();
 std::chrono::nanoseconds timeSpentLastMove = std::chrono::milliseconds::zero();
 string gameResult;
 vector<string> moves;
+std::optional<PendingSearch> pendingSearch;
+std::atomic<bool> stopSearch = false;
+
+// live search telemetry published by the engine
+TelemetryRing telemetryRing;
+struct TelemetryHistory {
+  static constexpr size_t MAX_SAMPLES = 2000;
+  std::vector<float> nps;          // every sample, across moves
+  std::vector<float> depthPerMove; // NegaMax depth reached on each move
+  TelemetrySample latest;
+  bool hasLatest = false;
+  TelemetrySample lastFinal; // totals of the move that just finished
+  bool hasFinal = false;
+
+  void clear() {
+    nps.clear();
+    depthPerMove.clear();
+    hasLatest = false;
+    hasFinal = false;
+  }
+} telemetryHistory;
+
+// per-move latency of each side, kept across games (Reset) so long
+// engine-vs-engine sessions show how close moves come to the limit
+struct MoveLatency {
+  int game;
+  int ply;
+  std::string side;
+  std::string move;
+  double ms;
+  uint64_t nodes; // 0 == not reported (book move, mate solver)
+  uint64_t nps;
+};
+
+struct LatencyLog {
+  static constexpr int BINS = 40; // MOVE_TIME_LIMIT_MS / BINS wide, plus one past the limit
+  std::vector<MoveLatency> moves;
+  std::map<std::string, std::vector<double>> sortedMS; // by side
+  int game = 1;
+  char csvPath[256] = "move-latency.csv";
+  std::string status;
+
+  void add(const MoveLatency &latency) {
+    moves.push_back(latency);
+    auto &sorted = sortedMS[latency.side];
+    sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), latency.ms),
+                  latency.ms);
+  }
+
+  void clear() {
+    moves.clear();
+    sortedMS.clear();
+    game = 1;
+    status.clear();
+  }
+} latencyLog;
+
+// nearest-rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  size_t rank = (size_t)std::ceil(p * sorted.size());
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+bool exportLatencyCsv(const std::string &path) {
+  std::ofstream file(path);
+  if (!file)
+    return false;
+  file << "game,ply,side,move,ms,nodes,nps,limit_ms,headroom_ms\n";
+  for (const MoveLatency &m : latencyLog.moves)
+    file << m.game << ',' << m.ply << ',' << m.side << ',' << m.move << ','
+         << m.ms << ',' << m.nodes << ',' << m.nps << ',' << MOVE_TIME_LIMIT_MS
+         << ',' << MOVE_TIME_LIMIT_MS - m.ms << '\n';
+  return bool(file);
+}
+
+void drawLatencyPanel() {
+  ImGui::Begin("Move latency", nullptr);
+  ImGui::Text("Limit: %dms  Game: %d  Moves: %zu", MOVE_TIME_LIMIT_MS,
+              latencyLog.game, latencyLog.moves.size());
+  for (const auto &[side, sorted] : latencyLog.sortedMS) {
+    ImGui::Separator();
+    double max = sorted.back();
+    ImGui::Text("%s: %zu moves", side.c_str(), sorted.size());
+    ImGui::Text("p50 %.0fms  p95 %.0fms  p99 %.0fms  max %.0fms",
+                percentile(sorted, 0.50), percentile(sorted, 0.95),
+                percentile(sorted, 0.99), max);
+    double headroom = MOVE_TIME_LIMIT_MS - max;
+    ImVec4 color = headroom < MOVE_TIME_LIMIT_MS * 0.05
+                       ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f)
+                       : ImVec4(0.5f, 1.0f, 0.5f, 1.0f);
+    ImGui::TextColored(color, "Headroom at max: %.0fms", headroom);
+
+    // last reported node count of this side
+    for (auto it = latencyLog.moves.rbegin(); it != latencyLog.moves.rend();
+         ++it) {
+      if (it->side != side || it->nodes == 0)
+        continue;
+      ImGui::Text("Last: %llu nodes, %llu NPS", (unsigned long long)it->nodes,
+                  (unsigned long long)it->nps);
+      break;
+    }
+
+    float bins[LatencyLog::BINS + 1] = {};
+    double binMS = double(MOVE_TIME_LIMIT_MS) / LatencyLog::BINS;
+    for (double ms : sorted)
+      bins[std::min(LatencyLog::BINS, int(ms / binMS))]++;
+    char label[64];
+    std::snprintf(label, sizeof(label), "##latency%s", side.c_str());
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "%.0fms bins, last is over",
+                  binMS);
+    ImGui::PlotHistogram(label, bins, LatencyLog::BINS + 1, 0, overlay, 0.0f,
+                         FLT_MAX, ImVec2(-1, 80));
+  }
+
+  ImGui::Separator();
+  ImGui::InputText("##csv", latencyLog.csvPath, sizeof(latencyLog.csvPath));
+  ImGui::SameLine();
+  if (ImGui::Button("Export CSV"))
+    latencyLog.status = exportLatencyCsv(latencyLog.csvPath)
+                            ? "Wrote " + std::to_string(latencyLog.moves.size()) +
+                                  " moves"
+                            : "Failed to write " + std::string(latencyLog.csvPath);
+  ImGui::SameLine();
+  if (ImGui::Button("Clear"))
+    latencyLog.clear();
+  if (!latencyLog.status.empty())
+    ImGui::Text("%s", latencyLog.status.c_str());
+  ImGui::End();
+}
+
+// returns true when there were new samples to show
+bool drainTelemetry() {
+  TelemetrySample sample;
+  bool any = false;
+  while (telemetryRing.Pop(sample)) {
+    any = true;
+    if (telemetryHistory.nps.size() >= TelemetryHistory::MAX_SAMPLES)
+      telemetryHistory.nps.erase(telemetryHistory.nps.begin());
+    telemetryHistory.nps.push_back(float(sample.nps));
+    if (sample.final && sample.engine == TelemetrySample::Engine::NEGAMAX)
+      telemetryHistory.depthPerMove.push_back(float(sample.depth));
+    if (sample.final) {
+      telemetryHistory.lastFinal = sample;
+      telemetryHistory.hasFinal = true;
+    }
+    telemetryHistory.latest = sample;
+    telemetryHistory.hasLatest = true;
+  }
+  return any;
+}
+
+void drawTelemetryPanel() {
+  ImGui::Begin("Search telemetry", nullptr);
+  const auto &s = telemetryHistory.latest;
+  if (!telemetryHistory.hasLatest) {
+    ImGui::Text("No samples yet");
+  } else {
+    bool negamax = s.engine == TelemetrySample::Engine::NEGAMAX;
+    ImGui::Text("%s%s", negamax ? "NegaMax" : "MCTS",
+                s.final ? " (done)" : "");
+    ImGui::Text("Time: %lldms  %s: %llu  NPS: %llu", (long long)s.timeMS,
+                negamax ? "Nodes" : "Playouts", (unsigned long long)s.nodes,
+                (unsigned long long)s.nps);
+    if (negamax) {
+      ImGui::Text("Depth: %d  Score: %+.2f", s.depth, s.score / 100.0);
+      ImGui::TextWrapped("PV: %s", s.pv);
+    } else {
+      for (int i = 0; i < s.numTopChildren; i++) {
+        char label[32];
+        std::snprintf(label, sizeof(label), "%s %.1f%%", s.topMoves[i],
+                      s.topShares[i] * 100.0f);
+        ImGui::ProgressBar(s.topShares[i], ImVec2(-1, 0), label);
+      }
+    }
+  }
+
+  ImGui::Separator();
+  auto &nps = telemetryHistory.nps;
+  ImGui::PlotLines("NPS", nps.data(), (int)nps.size(), 0, nullptr, 0.0f,
+                   FLT_MAX, ImVec2(0, 80));
+  auto &depth = telemetryHistory.depthPerMove;
+  ImGui::PlotHistogram("Depth/move", depth.data(), (int)depth.size(), 0,
+                       nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+  ImGui::Text("Dropped samples: %llu",
+              (unsigned long long)telemetryRing.Dropped());
+  ImGui::End();
+}
+
+// ask the in-flight search (if any) to stop and forget its result
+void cancelSearch() {
+  if (pendingSearch) {
+    pendingSearch->discard = true;
+    stopSearch = true;
+  }
+}
 
 void reset(chess::Board &board) {
+  cancelSearch();
   board = chess::Board();
   simulationState = SimulationState::PAUSED;
   timeSpentOnMoves = std::chrono::nanoseconds::zero();
   timeSpentLastMove = std::chrono::milliseconds::zero();
   gameResult = "";
+  if (!moves.empty())
+    latencyLog.game++;
   moves.clear();
+  telemetryHistory.clear();
 }
 
-void move(chess::Board &board) {
+// returns true (and pauses) when there is no move to make
+bool checkGameOver(chess::Board &board) {
   if (board.isHalfMoveDraw()) {
     auto result = board.getHalfMoveDrawType();
     gameResult = std::string(magic_enum::enum_name(result.second)) + " " +
                  std::string(magic_enum::enum_name(result.first));
-    return;
+    return true;
   }
   auto result = board.isGameOver();
   if (result.second != chess::GameResult::NONE ||
@@ -66,17 +292,53 @@ void move(chess::Board &board) {
     gameResult = std::string(magic_enum::enum_name(result.second)) + " " +
                  std::string(magic_enum::enum_name(result.first));
     simulationState = SimulationState::PAUSED;
-    return;
+    return true;
   }
+  return false;
+}
 
-  std::string turn(magic_enum::enum_name(board.sideToMove().internal()));
-  // get stats
-  auto beforeTime = std::chrono::high_resolution_clock::now();
+// start searching the current position on a worker thread
+void move(chess::Board &board) {
+  if (pendingSearch || checkGameOver(board))
+    return;
 
-  // run!
-  auto moveStr = ChessSimulator::Move(board.getFen(true));
+  PendingSearch search;
+  search.turn = magic_enum::enum_name(board.sideToMove().internal());
   // get stats
-  auto afterTime = std::chrono::high_resolution_clock::now();
+  search.startTime = std::chrono::high_resolution_clock::now();
+  // run!
+  stopSearch = false;
+  telemetryHistory.hasFinal = false;
+  search.result =
+      std::async(std::launch::async, [fen = board.getFen(true)]() {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string move =
+            ChessSimulator::Move(fen, MOVE_TIME_LIMIT_MS, &stopSearch);
+        return SearchResult{move,
+                            std::chrono::high_resolution_clock::now() - start};
+      });
+  pendingSearch = std::move(search);
+}
+
+// apply the worker's move once it is ready, without blocking the frame;
+// returns true when a search finished
+bool pollSearch(chess::Board &board) {
+  if (!pendingSearch || pendingSearch->result.wait_for(std::chrono::seconds(
+                            0)) != std::future_status::ready)
+    return false;
+
+  auto result = pendingSearch->result.get();
+  auto moveStr = result.move;
+  auto search = std::move(*pendingSearch);
+  pendingSearch.reset();
+  // the worker pushed its final sample before returning, but the frame's
+  // drain may have run before that: drain again so it is this move's
+  drainTelemetry();
+  bool reported = telemetryHistory.hasFinal;
+  telemetryHistory.hasFinal = false;
+  if (search.discard)
+    return true;
+
   // apply move
   // remove \n if present
   moveStr.erase(std::remove(moveStr.begin(), moveStr.end(), '\n'),
@@ -85,99 +347,129 @@ void move(chess::Board &board) {
   board.makeMove(move);
 
   // update stats
-  timeSpentOnMoves += afterTime - beforeTime;
-  timeSpentLastMove = afterTime - beforeTime;
-  moves.push_back(std::to_string(board.fullMoveNumber()) + " " + turn + ": " +
-                  moveStr);
+  timeSpentOnMoves += result.elapsed;
+  timeSpentLastMove = result.elapsed;
+  moves.push_back(std::to_string(board.fullMoveNumber()) + " " + search.turn +
+                  ": " + moveStr);
+  const auto &totals = telemetryHistory.lastFinal;
+  latencyLog.add({latencyLog.game, (int)moves.size(), search.turn, moveStr,
+                  std::chrono::duration<double, std::milli>(result.elapsed)
+                      .count(),
+                  reported ? totals.nodes : 0, reported ? totals.nps : 0});
+  return true;
 }
 
-struct Texture {
-  SDL_Texture *texture;
-  SDL_Surface *surface;
-  ~Texture() {
-    if (texture)
-      SDL_DestroyTexture(texture);
-    if (surface)
-      SDL_FreeSurface(surface);
-  }
-};
+// All 12 pieces rasterized once into one texture, in chess::Piece order
+// (WHITEPAWN..BLACKKING), each PIECE_SIZE square. The rasterized pixels are
+// cached as a BMP in SDL's pref path, keyed by a hash of the SVGs and the
+// size, so later runs skip nanosvg entirely.
+const int PIECE_SIZE = 128;
+const int ATLAS_PIECES = 12;
+
+// frame pacing
+const int DEFAULT_FRAME_CAP = 30; // most redraws per second
+const int IDLE_WAIT_MS = 500;     // longest sleep between checks when idle
+const int SETTLE_FRAMES = 3;      // frames drawn after input or a move
+
+SDL_Surface *rasterizePieceAtlas(std::vector<unsigned char> &pixels) {
+  const char *svgs[ATLAS_PIECES] = {
+      PawnWhiteSvgString,  KnightWhiteSvgString, BishopWhiteSvgString,
+      RookWhiteSvgString,  QueenWhiteSvgString,  KingWhiteSvgString,
+      PawnBlackSvgString,  KnightBlackSvgString, BishopBlackSvgString,
+      RookBlackSvgString,  QueenBlackSvgString,  KingBlackSvgString};
+  int width = PIECE_SIZE * ATLAS_PIECES;
+  pixels.assign(size_t(width) * PIECE_SIZE * 4, 0);
 
-Texture *SvgStringToTexture(std::string svgString, SDL_Renderer *renderer, int size = 64) {
-  Texture *tex = new Texture();
-  
-  // Parse SVG from string
-  NSVGimage *image = nsvgParse(const_cast<char*>(svgString.c_str()), "px", 96.0f);
-  if (!image) {
-    std::cerr << "Failed to parse SVG" << std::endl;
-    return tex;
-  }
-  
-  // Create rasterizer
   NSVGrasterizer *rast = nsvgCreateRasterizer();
   if (!rast) {
-    nsvgDelete(image);
     std::cerr << "Failed to create SVG rasterizer" << std::endl;
-    return tex;
+    return nullptr;
+  }
+  for (int i = 0; i < ATLAS_PIECES; i++) {
+    std::string svg = svgs[i]; // nsvgParse writes into the string
+    NSVGimage *image = nsvgParse(svg.data(), "px", 96.0f);
+    if (!image) {
+      std::cerr << "Failed to parse SVG" << std::endl;
+      continue;
+    }
+    // fit and center in the piece's cell
+    float scale = PIECE_SIZE / std::max(image->width, image->height);
+    float offsetX = (PIECE_SIZE - image->width * scale) / 2.0f;
+    float offsetY = (PIECE_SIZE - image->height * scale) / 2.0f;
+    nsvgRasterize(rast, image, offsetX, offsetY, scale,
+                  &pixels[size_t(i) * PIECE_SIZE * 4], PIECE_SIZE, PIECE_SIZE,
+                  width * 4);
+    nsvgDelete(image);
   }
-  
-  // Calculate scale to fit in desired size
-  float scale = size / std::max(image->width, image->height);
-  int w = static_cast<int>(image->width * scale);
-  int h = static_cast<int>(image->height * scale);
-  
-  // Allocate pixel buffer (RGBA)
-  unsigned char *pixels = new unsigned char[w * h * 4];
-  
-  // Rasterize SVG to pixel buffer
-  nsvgRasterize(rast, image, 0, 0, scale, pixels, w, h, w * 4);
-  
-  // Create SDL surface from pixel buffer
-  tex->surface = SDL_CreateRGBSurfaceFrom(
-      pixels, w, h, 32, w * 4,
-      0x000000FF,  // R mask
-      0x0000FF00,  // G mask
-      0x00FF0000,  // B mask
-      0xFF000000   // A mask
-  );
-  
-  // Create texture from surface
-  tex->texture = SDL_CreateTextureFromSurface(renderer, tex->surface);
-  
-  // Cleanup
   nsvgDeleteRasterizer(rast);
-  nsvgDelete(image);
-  delete[] pixels;
-  
-  // Note: We need to clear surface since we're freeing the pixel buffer
-  // The texture has a copy of the data
-  SDL_FreeSurface(tex->surface);
-  tex->surface = nullptr;
-
-  return tex;
+
+  return SDL_CreateRGBSurfaceFrom(pixels.data(), width, PIECE_SIZE, 32,
+                                  width * 4,
+                                  0x000000FF, // R mask
+                                  0x0000FF00, // G mask
+                                  0x00FF0000, // B mask
+                                  0xFF000000  // A mask
+  );
 }
-auto loadPiecesTextures(SDL_Renderer *renderer) {
-  std::map<char, Texture *> map;
-
-  map['P'] = SvgStringToTexture(PawnWhiteSvgString, renderer);
-  map['p'] = SvgStringToTexture(PawnBlackSvgString, renderer);
-  map['R'] = SvgStringToTexture(RookWhiteSvgString, renderer);
-  map['r'] = SvgStringToTexture(RookBlackSvgString, renderer);
-  map['N'] = SvgStringToTexture(KnightWhiteSvgString, renderer);
-  map['n'] = SvgStringToTexture(KnightBlackSvgString, renderer);
-  map['B'] = SvgStringToTexture(BishopWhiteSvgString, renderer);
-  map['b'] = SvgStringToTexture(BishopBlackSvgString, renderer);
-  map['Q'] = SvgStringToTexture(QueenWhiteSvgString, renderer);
-  map['q'] = SvgStringToTexture(QueenBlackSvgString, renderer);
-  map['K'] = SvgStringToTexture(KingWhiteSvgString, renderer);
-  map['k'] = SvgStringToTexture(KingBlackSvgString, renderer);
-
-  return map;
+
+std::string pieceAtlasCachePath() {
+  // FNV-1a over the SVGs and the size: a changed piece set misses the cache
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  auto mix = [&](const std::string &data) {
+    for (unsigned char c : data)
+      hash = (hash ^ c) * 0x100000001b3ULL;
+  };
+  for (const char *svg :
+       {PawnWhiteSvgString, KnightWhiteSvgString, BishopWhiteSvgString,
+        RookWhiteSvgString, QueenWhiteSvgString, KingWhiteSvgString,
+        PawnBlackSvgString, KnightBlackSvgString, BishopBlackSvgString,
+        RookBlackSvgString, QueenBlackSvgString, KingBlackSvgString})
+    mix(svg);
+  mix(std::to_string(PIECE_SIZE));
+
+  char *prefPath = SDL_GetPrefPath("chess-gui", "chess-gui");
+  if (!prefPath)
+    return "";
+  char name[64];
+  std::snprintf(name, sizeof(name), "pieces-%016llx.bmp",
+                (unsigned long long)hash);
+  std::string path = std::string(prefPath) + name;
+  SDL_free(prefPath);
+  return path;
+}
+
+SDL_Texture *loadPieceAtlas(SDL_Renderer *renderer) {
+  std::string cachePath = pieceAtlasCachePath();
+  SDL_Surface *surface =
+      cachePath.empty() ? nullptr : SDL_LoadBMP(cachePath.c_str());
+  if (surface && (surface->w != PIECE_SIZE * ATLAS_PIECES ||
+                  surface->h != PIECE_SIZE)) {
+    SDL_FreeSurface(surface);
+    surface = nullptr;
+  }
+
+  std::vector<unsigned char> pixels; // backs a freshly rasterized surface
+  if (!surface) {
+    surface = rasterizePieceAtlas(pixels);
+    if (!surface)
+      return nullptr;
+    if (!cachePath.empty() && SDL_SaveBMP(surface, cachePath.c_str()) != 0)
+      SDL_Log("Failed to cache the piece atlas: %s", SDL_GetError());
+  }
+
+  SDL_Texture *atlas = SDL_CreateTextureFromSurface(renderer, surface);
+  SDL_FreeSurface(surface);
+  if (atlas)
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+  return atlas;
 }
 
 int main(int argc, char *argv[]) {
-  // Unused argc, argv
-  (void)argc;
-  (void)argv;
+  // chessgui [--fps n]: cap the redraw rate (0 == vsync only)
+  int frameCap = DEFAULT_FRAME_CAP;
+  for (int i = 1; i + 1 < argc; i++)
+    if (std::string(argv[i]) == "--fps")
+      frameCap = std::max(0, std::atoi(argv[++i]));
 
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMECONTROLLER) !=
       0) {
@@ -213,7 +505,8 @@ int main(int argc, char *argv[]) {
     abort();
   }
 
-  auto piecesTextures = loadPiecesTextures(renderer);
+  SDL_Texture *pieceAtlas = loadPieceAtlas(renderer);
+  ChessSimulator::SetTelemetry(&telemetryRing);
 
   chess::Board board;
 
@@ -238,15 +531,34 @@ int main(int argc, char *argv[]) {
 
   // Main loop
   bool done = false;
+  int framesToRender = SETTLE_FRAMES;
+  auto lastFrame = std::chrono::steady_clock::now();
 
-  // Event loop
+  // Event loop: redraw only when something changed. Idle, the loop sleeps in
+  // SDL_WaitEventTimeout until input arrives; while a search runs it redraws
+  // the live telemetry at most frameCap times a second.
   while (!done) {
+    if (drainTelemetry())
+      framesToRender = std::max(framesToRender, 1);
+    if (pollSearch(board))
+      framesToRender = SETTLE_FRAMES;
     if (simulationState == SimulationState::RUNNING)
       move(board);
+    bool searching = pendingSearch.has_value();
+
+    int waitMS = IDLE_WAIT_MS;
+    if (searching || framesToRender > 0) {
+      auto nextFrame = lastFrame + std::chrono::milliseconds(
+                                       frameCap > 0 ? 1000 / frameCap : 0);
+      waitMS = (int)std::max<int64_t>(
+          0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                 nextFrame - std::chrono::steady_clock::now())
+                 .count());
+    }
 
     SDL_Event event;
-
-    while (SDL_PollEvent(&event)) {
+    bool hasEvent = SDL_WaitEventTimeout(&event, waitMS) != 0;
+    while (hasEvent) {
       ImGui_ImplSDL2_ProcessEvent(&event);
       if (event.type == SDL_QUIT)
         done = true;
@@ -254,8 +566,20 @@ int main(int argc, char *argv[]) {
           event.window.event == SDL_WINDOWEVENT_CLOSE &&
           event.window.windowID == SDL_GetWindowID(window))
         done = true;
+      framesToRender = SETTLE_FRAMES; // ImGui needs a few frames to settle
+      hasEvent = SDL_PollEvent(&event) != 0;
     }
 
+    // nothing changed: don't touch the GPU or ImGui //
+    if (!searching && framesToRender <= 0)
+      continue;
+    if (frameCap > 0 && std::chrono::steady_clock::now() - lastFrame <
+                            std::chrono::milliseconds(1000 / frameCap))
+      continue;
+    lastFrame = std::chrono::steady_clock::now();
+    if (framesToRender > 0)
+      framesToRender--;
+
     // Start the Dear ImGui frame
     ImGui_ImplSDLRenderer2_NewFrame();
     ImGui_ImplSDL2_NewFrame();
@@ -268,6 +592,9 @@ int main(int argc, char *argv[]) {
                 1.0f / ImGui::GetIO().DeltaTime,
                 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 
+    ImGui::SliderInt("Frame cap", &frameCap, 0, 144,
+                     frameCap > 0 ? "%d FPS" : "vsync");
+
     ImGui::Separator();
     if (ImGui::Button("Reset")) {
       simulationState = SimulationState::RUNNING;
@@ -280,6 +607,7 @@ int main(int argc, char *argv[]) {
     ImGui::SameLine();
     if (ImGui::Button("Pause")) {
       simulationState = SimulationState::PAUSED;
+      cancelSearch();
     }
     ImGui::SameLine();
     if (ImGui::Button("Step")) {
@@ -292,6 +620,14 @@ int main(int argc, char *argv[]) {
     ImGui::Text("Last move dur:  %.3fms",
                 timeSpentLastMove.count() / 1000000.0);
 
+    if (pendingSearch)
+      ImGui::Text("Thinking: %.0fms",
+                  std::chrono::duration<double, std::milli>(
+                      std::chrono::high_resolution_clock::now() -
+                      pendingSearch->startTime)
+                      .count());
+    else
+      ImGui::Text("Idle");
     ImGui::Text("Game result: %s", gameResult.c_str());
     // moves
     ImGui::Separator();
@@ -302,6 +638,9 @@ int main(int argc, char *argv[]) {
     ImGui::EndChild(); // end child moves
     ImGui::End();      // end settings
 
+    drawTelemetryPanel();
+    drawLatencyPanel();
+
     // Rendering
     ImGui::Render();
 
@@ -334,57 +673,10 @@ int main(int argc, char *argv[]) {
           SDL_RenderFillRect(renderer, &squareRect);
         }
 
-        switch (board.at(chess::Square(row * 8 + col)).internal()) {
-        case chess::Piece::underlying::WHITEPAWN:
-          SDL_RenderCopy(renderer, piecesTextures['P']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::BLACKPAWN:
-          SDL_RenderCopy(renderer, piecesTextures['p']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::WHITEROOK:
-          SDL_RenderCopy(renderer, piecesTextures['R']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::BLACKROOK:
-          SDL_RenderCopy(renderer, piecesTextures['r']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::WHITEKNIGHT:
-          SDL_RenderCopy(renderer, piecesTextures['N']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::BLACKKNIGHT:
-          SDL_RenderCopy(renderer, piecesTextures['n']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::WHITEBISHOP:
-          SDL_RenderCopy(renderer, piecesTextures['B']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::BLACKBISHOP:
-          SDL_RenderCopy(renderer, piecesTextures['b']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::WHITEQUEEN:
-          SDL_RenderCopy(renderer, piecesTextures['Q']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::BLACKQUEEN:
-          SDL_RenderCopy(renderer, piecesTextures['q']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::WHITEKING:
-          SDL_RenderCopy(renderer, piecesTextures['K']->texture, nullptr,
-                         &squareRect);
-          break;
-        case chess::Piece::underlying::BLACKKING:
-          SDL_RenderCopy(renderer, piecesTextures['k']->texture, nullptr,
-                         &squareRect);
-          break;
-        default:
-          break;
+        int piece = (int)board.at(chess::Square(row * 8 + col)).internal();
+        if (pieceAtlas && piece < ATLAS_PIECES) {
+          SDL_Rect pieceRect = {piece * PIECE_SIZE, 0, PIECE_SIZE, PIECE_SIZE};
+          SDL_RenderCopy(renderer, pieceAtlas, &pieceRect, &squareRect);
         }
       }
     }
@@ -392,15 +684,18 @@ int main(int argc, char *argv[]) {
     // present ui on top of your drawings
     ImGui_ImplSDLRenderer2_RenderDrawData(ImGui::GetDrawData(), renderer);
     SDL_RenderPresent(renderer);
-
-    SDL_Delay(0);
   }
 
   // Cleanup
+  cancelSearch();
+  if (pendingSearch)
+    pendingSearch->result.wait();
   ImGui_ImplSDLRenderer2_Shutdown();
   ImGui_ImplSDL2_Shutdown();
   ImGui::DestroyContext();
 
+  if (pieceAtlas)
+    SDL_DestroyTexture(pieceAtlas);
   SDL_DestroyRenderer(renderer);
   SDL_DestroyWindow(window);
   SDL_Quit();
@@ -0,0 +1,279 @@
+// Headless engine-vs-engine match runner.
+// Plays game pairs (colours swapped) from EPD openings on every core and
+// reports Elo, error bars and an SPRT verdict.
+//
+// chessmatch --engine1 negamax --engine2 mcts:c=1.0 --openings book.epd
+//            --games 1000 --concurrency 12 --movetime 100 --sprt 0 5
+
+#include "chess.hpp"
+#include "memory-budget.h"
+#include "players.h"
+#include "sprt.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MatchConfig {
+  PlayerSpec engines[2];
+  std::vector<std::string> openings;
+  int games = 100;
+  int concurrency = std::max(1u, std::thread::hardware_concurrency());
+  int movetimeMS = 100;
+  uint64_t nodes = 0;     // fixed nodes/playouts per move instead of a time limit
+  int timeMarginMS = 100; // allowed overshoot before a move loses on time
+  int maxPlies = 400;     // adjudicate as a draw after this
+  bool useSPRT = false;
+  SPRT sprt;
+};
+
+enum class Termination { NORMAL, ILLEGAL_MOVE, TIME_FORFEIT, ADJUDICATION };
+
+struct GameResult {
+  double whiteScore; // 1, 0.5 or 0
+  Termination termination;
+};
+
+// EPD: the first four fields are the position; opcodes are ignored
+std::vector<std::string> LoadOpenings(const std::string &path) {
+  std::vector<std::string> openings;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::stringstream ss(line);
+    std::string fields[4];
+    if (!(ss >> fields[0] >> fields[1] >> fields[2] >> fields[3]))
+      continue;
+    openings.push_back(fields[0] + " " + fields[1] + " " + fields[2] + " " +
+                       fields[3] + " 0 1");
+  }
+  return openings;
+}
+
+GameResult PlayGame(const std::string &openingFen, Player &white,
+                    Player &black, const MatchConfig &config) {
+  chess::Board board(openingFen);
+
+  for (int ply = 0; ply < config.maxPlies; ply++) {
+    auto over = board.isGameOver();
+    if (over.second != chess::GameResult::NONE) {
+      if (over.second == chess::GameResult::DRAW)
+        return {0.5, Termination::NORMAL};
+      // the side to move lost
+      return {board.sideToMove() == chess::Color::WHITE ? 0.0 : 1.0,
+              Termination::NORMAL};
+    }
+
+    bool whiteToMove = board.sideToMove() == chess::Color::WHITE;
+    double loss = whiteToMove ? 0.0 : 1.0;
+    Player &player = whiteToMove ? white : black;
+
+    SearchLimits limits;
+    if (config.nodes > 0)
+      limits.nodes = config.nodes;
+    else
+      limits.movetimeMS = config.movetimeMS;
+
+    auto before = std::chrono::steady_clock::now();
+    std::string uci = player.Move(board.getFen(), limits);
+    auto elapsedMS = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now() - before)
+                         .count();
+    if (config.nodes == 0 &&
+        elapsedMS > config.movetimeMS + config.timeMarginMS)
+      return {loss, Termination::TIME_FORFEIT};
+
+    // no move at all (a stopped or broken engine) forfeits like an illegal one
+    if (uci.empty())
+      return {loss, Termination::ILLEGAL_MOVE};
+
+    chess::Movelist legal;
+    chess::movegen::legalmoves(legal, board);
+    auto move = chess::uci::uciToMove(board, uci);
+    if (std::find(legal.begin(), legal.end(), move) == legal.end())
+      return {loss, Termination::ILLEGAL_MOVE};
+    board.makeMove(move);
+  }
+
+  return {0.5, Termination::ADJUDICATION};
+}
+
+void PrintUsage() {
+  std::cerr
+      << "usage: chessmatch --engine1 <spec> --engine2 <spec> [options]\n"
+         "  --openings <file.epd>   opening positions (default: start "
+         "position)\n"
+         "  --games <n>             number of games, rounded up to pairs\n"
+         "  --concurrency <n>       games played at once (default: all "
+         "cores)\n"
+         "  --movetime <ms>         time per move\n"
+         "  --nodes <n>             fixed nodes (MCTS: playouts) per move, "
+         "reproducible\n"
+         "  --timemargin <ms>       overshoot allowed before losing on "
+         "time\n"
+         "  --maxplies <n>          adjudicate a draw after n plies\n"
+         "  --sprt <elo0> <elo1>    stop once the SPRT concludes\n"
+         "  --alpha <a> --beta <b>  SPRT error rates (default 0.05)\n"
+         "engine specs: negamax, negamax:nnue=<file>, negamax:tt=off, mcts, "
+         "mcts:c=<C>, random\n";
+}
+
+bool ParseArgs(int argc, char *argv[], MatchConfig &config) {
+  std::string specs[2], openingsPath;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto next = [&]() -> std::string {
+      return i + 1 < argc ? argv[++i] : "";
+    };
+    if (arg == "--engine1")
+      specs[0] = next();
+    else if (arg == "--engine2")
+      specs[1] = next();
+    else if (arg == "--openings")
+      openingsPath = next();
+    else if (arg == "--games")
+      config.games = std::stoi(next());
+    else if (arg == "--concurrency")
+      config.concurrency = std::max(1, std::stoi(next()));
+    else if (arg == "--movetime")
+      config.movetimeMS = std::stoi(next());
+    else if (arg == "--nodes")
+      config.nodes = std::stoull(next());
+    else if (arg == "--timemargin")
+      config.timeMarginMS = std::stoi(next());
+    else if (arg == "--maxplies")
+      config.maxPlies = std::stoi(next());
+    else if (arg == "--sprt") {
+      config.useSPRT = true;
+      config.sprt.elo0 = std::stod(next());
+      config.sprt.elo1 = std::stod(next());
+    } else if (arg == "--alpha")
+      config.sprt.alpha = std::stod(next());
+    else if (arg == "--beta")
+      config.sprt.beta = std::stod(next());
+    else {
+      std::cerr << "unknown argument: " << arg << std::endl;
+      return false;
+    }
+  }
+
+  for (int e = 0; e < 2; e++) {
+    std::string error;
+    if (specs[e].empty()) {
+      std::cerr << "missing --engine" << e + 1 << std::endl;
+      return false;
+    }
+    if (!PlayerSpec::Parse(specs[e], config.engines[e], error)) {
+      std::cerr << "engine" << e + 1 << ": " << error << std::endl;
+      return false;
+    }
+  }
+
+  if (!openingsPath.empty()) {
+    config.openings = LoadOpenings(openingsPath);
+    if (config.openings.empty()) {
+      std::cerr << "no openings read from " << openingsPath << std::endl;
+      return false;
+    }
+  } else
+    config.openings.push_back(chess::constants::STARTPOS);
+
+  config.games += config.games % 2; // every opening is played with both colours
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  MatchConfig config;
+  if (!ParseArgs(argc, argv, config)) {
+    PrintUsage();
+    return 1;
+  }
+
+  MatchStats stats;
+  int timeForfeits = 0, illegalMoves = 0, adjudications = 0;
+  std::mutex statsMutex;
+  std::atomic<int> nextGame = 0;
+  std::atomic<bool> stop = false;
+  auto start = std::chrono::steady_clock::now();
+
+  auto worker = [&]() {
+    while (!stop) {
+      int game = nextGame++;
+      if (game >= config.games)
+        return;
+
+      // game pairs share an opening; engine 1 plays white in even games
+      const std::string &opening =
+          config.openings[(game / 2) % config.openings.size()];
+      bool engine1White = 0 == game % 2;
+      auto player1 = config.engines[0].Create();
+      auto player2 = config.engines[1].Create();
+      GameResult result =
+          engine1White ? PlayGame(opening, *player1, *player2, config)
+                       : PlayGame(opening, *player2, *player1, config);
+      double score1 = engine1White ? result.whiteScore : 1.0 - result.whiteScore;
+
+      std::lock_guard<std::mutex> lock(statsMutex);
+      if (score1 == 1.0)
+        stats.wins++;
+      else if (score1 == 0.0)
+        stats.losses++;
+      else
+        stats.draws++;
+      timeForfeits += result.termination == Termination::TIME_FORFEIT;
+      illegalMoves += result.termination == Termination::ILLEGAL_MOVE;
+      adjudications += result.termination == Termination::ADJUDICATION;
+
+      std::printf("Game %d/%d  W-D-L %d-%d-%d  Elo %.1f +/- %.1f",
+                  stats.Games(), config.games, stats.wins, stats.draws,
+                  stats.losses, stats.Elo(), stats.EloError());
+      if (config.useSPRT) {
+        std::printf("  LLR %.2f [%.2f, %.2f]",
+                    stats.LLR(config.sprt.elo0, config.sprt.elo1),
+                    config.sprt.LowerBound(), config.sprt.UpperBound());
+        if (config.sprt.Verdict(stats) != 0)
+          stop = true;
+      }
+      std::printf("\n");
+      std::fflush(stdout);
+    }
+  };
+
+  // two engines per concurrent game share the memory budget
+  MemoryBudget::Global().SetConcurrency(2 * config.concurrency);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < config.concurrency; i++)
+    threads.emplace_back(worker);
+  for (auto &thread : threads)
+    thread.join();
+
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  std::printf("\nFinished %d games in %.1fs (%d concurrent)\n", stats.Games(),
+              seconds, config.concurrency);
+  std::printf("Score of engine1 vs engine2: %d - %d - %d [%.3f]\n", stats.wins,
+              stats.losses, stats.draws, stats.Score());
+  std::printf("Elo difference: %.1f +/- %.1f (95%%)\n", stats.Elo(),
+              stats.EloError());
+  std::printf("Time forfeits: %d, illegal moves: %d, adjudicated draws: %d\n",
+              timeForfeits, illegalMoves, adjudications);
+  if (config.useSPRT) {
+    int verdict = config.sprt.Verdict(stats);
+    std::printf("SPRT (elo0=%.1f, elo1=%.1f, alpha=%.2f, beta=%.2f): LLR "
+                "%.2f -> %s\n",
+                config.sprt.elo0, config.sprt.elo1, config.sprt.alpha,
+                config.sprt.beta, stats.LLR(config.sprt.elo0, config.sprt.elo1),
+                verdict > 0   ? "H1 accepted"
+                : verdict < 0 ? "H0 accepted"
+                              : "inconclusive");
+  }
+  return 0;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "mcts.h"
+#include "negamax.h"
+#include "nnue.h"
+#include "randombot.h"
+#include "search-limits.h"
+#include "telemetry.h"
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+// One engine configuration, created fresh for every game.
+//
+// Spec format: <engine>[:key=value[,key=value...]]
+//   negamax             PST evaluation
+//   negamax:nnue=<file> NNUE evaluation
+//   mcts:c=<double>     UCB1 exploration constant
+//   mcts:leaf=search    shallow search leaf evaluation instead of playouts,
+//                       with depth=<plies> (0: quiescence) and mix=<0..1>
+//                       (share of short random rollouts)
+//   random
+class Player {
+public:
+  virtual ~Player() = default;
+  virtual std::string Move(const std::string &fen,
+                           const SearchLimits &limits) = 0;
+  // live search samples (ignored by engines that don't publish any)
+  virtual void SetTelemetry(TelemetryRing *) {}
+};
+
+class NegaMaxPlayer : public Player {
+public:
+  NegaMaxPlayer(const NNUENetwork *network, bool ttSearch) {
+    negamax.SetNetwork(network);
+    negamax.SetTTSearch(ttSearch);
+    negamax.Prepare(); // before the first move's clock starts
+  }
+  std::string Move(const std::string &fen,
+                   const SearchLimits &limits) override {
+    return negamax.Move(fen, limits);
+  }
+  void SetTelemetry(TelemetryRing *ring) override {
+    negamax.SetTelemetry(ring);
+  }
+
+private:
+  NegaMax negamax;
+};
+
+class MCTSPlayer : public Player {
+public:
+  MCTSPlayer(double exploration, bool leafSearch, int leafDepth,
+             double rolloutMix) {
+    mcts.SetExploration(exploration);
+    mcts.SetLeafSearch(leafSearch, leafDepth, rolloutMix);
+    mcts.Prepare(); // before the first move's clock starts
+  }
+  std::string Move(const std::string &fen,
+                   const SearchLimits &limits) override {
+    return mcts.Move(fen, limits);
+  }
+  void SetTelemetry(TelemetryRing *ring) override { mcts.SetTelemetry(ring); }
+
+private:
+  MCTS mcts;
+};
+
+class RandomPlayer : public Player {
+public:
+  std::string Move(const std::string &fen, const SearchLimits &) override {
+    return randomBot.Move(fen);
+  }
+
+private:
+  RandomBot randomBot;
+};
+
+struct PlayerSpec {
+  std::string engine;
+  std::map<std::string, std::string> options;
+  std::shared_ptr<NNUENetwork> network; // loaded once, shared by all games
+
+  static bool Parse(const std::string &spec, PlayerSpec &out,
+                    std::string &error) {
+    auto colon = spec.find(':');
+    out.engine = spec.substr(0, colon);
+    if (colon != std::string::npos) {
+      std::stringstream ss(spec.substr(colon + 1));
+      std::string option;
+      while (std::getline(ss, option, ',')) {
+        auto eq = option.find('=');
+        if (eq == std::string::npos) {
+          error = "expected key=value in '" + option + "'";
+          return false;
+        }
+        out.options[option.substr(0, eq)] = option.substr(eq + 1);
+      }
+    }
+
+    if (out.engine != "negamax" && out.engine != "mcts" &&
+        out.engine != "random") {
+      error = "unknown engine '" + out.engine + "'";
+      return false;
+    }
+    if (out.options.count("nnue")) {
+      out.network = NNUENetwork::Load(out.options["nnue"]);
+      if (!out.network) {
+        error = "failed to load NNUE network '" + out.options["nnue"] + "'";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::unique_ptr<Player> Create() const {
+    if (engine == "negamax") {
+      auto tt = options.find("tt");
+      return std::make_unique<NegaMaxPlayer>(
+          network.get(), tt == options.end() || tt->second != "off");
+    }
+    if (engine == "mcts") {
+      auto number = [&](const std::string &key, double fallback) {
+        auto it = options.find(key);
+        return it != options.end() ? std::stod(it->second) : fallback;
+      };
+      auto leaf = options.find("leaf");
+      return std::make_unique<MCTSPlayer>(
+          number("c", std::sqrt(2.0)),
+          leaf != options.end() && leaf->second == "search",
+          int(number("depth", 0)), number("mix", 0.0));
+    }
+    return std::make_unique<RandomPlayer>();
+  }
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+// Match statistics from engine A's point of view.
+// Elo uses the logistic model; the SPRT uses the normal (GSPRT) approximation
+// of the log-likelihood ratio, as in fishtest/cutechess.
+struct MatchStats {
+  int wins = 0;
+  int draws = 0;
+  int losses = 0;
+
+  int Games() const { return wins + draws + losses; }
+
+  double Score() const {
+    return Games() ? (wins + 0.5 * draws) / Games() : 0.5;
+  }
+
+  // per-game variance of the score
+  double Variance() const {
+    if (!Games())
+      return 0.0;
+    double s = Score();
+    return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) +
+            losses * s * s) /
+           Games();
+  }
+
+  static double ScoreToElo(double score) {
+    score = std::clamp(score, 1e-6, 1 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+  }
+
+  static double EloToScore(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+  }
+
+  double Elo() const { return ScoreToElo(Score()); }
+
+  // half width of the 95% confidence interval, in Elo
+  double EloError() const {
+    if (!Games())
+      return 0.0;
+    double margin = 1.959964 * std::sqrt(Variance() / Games());
+    return (ScoreToElo(Score() + margin) - ScoreToElo(Score() - margin)) / 2;
+  }
+
+  double LLR(double elo0, double elo1) const {
+    double var = Variance();
+    if (var <= 0.0)
+      return 0.0;
+    double s0 = EloToScore(elo0), s1 = EloToScore(elo1);
+    return Games() * (s1 - s0) * (2 * Score() - s0 - s1) / (2 * var);
+  }
+};
+
+struct SPRT {
+  double elo0 = 0.0, elo1 = 5.0;
+  double alpha = 0.05, beta = 0.05;
+
+  double LowerBound() const { return std::log(beta / (1 - alpha)); }
+  double UpperBound() const { return std::log((1 - beta) / alpha); }
+
+  // -1: H0 accepted, 1: H1 accepted, 0: keep going
+  int Verdict(const MatchStats &stats) const {
+    double llr = stats.LLR(elo0, elo1);
+    if (llr >= UpperBound())
+      return 1;
+    if (llr <= LowerBound())
+      return -1;
+    return 0;
+  }
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include "chess.hpp"
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One test position: "<4 FEN fields> bm Qxf7+; am Nc3; id \"WAC.001\";"
+struct EpdPosition {
+  std::string id;
+  std::string fen;
+  std::vector<std::string> bestMoves;  // bm, as UCI
+  std::vector<std::string> avoidMoves; // am, as UCI
+
+  // solved if the move is one of the bm moves and none of the am moves
+  bool IsSolution(const std::string &uci) const {
+    if (uci.empty())
+      return false;
+    for (auto &am : avoidMoves)
+      if (am == uci)
+        return false;
+    if (bestMoves.empty())
+      return true;
+    for (auto &bm : bestMoves)
+      if (bm == uci)
+        return true;
+    return false;
+  }
+
+  static bool Parse(const std::string &line, EpdPosition &out) {
+    std::stringstream ss(line);
+    std::string fields[4];
+    if (!(ss >> fields[0] >> fields[1] >> fields[2] >> fields[3]))
+      return false;
+    out.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] +
+              " 0 1";
+    chess::Board board(out.fen);
+
+    // opcodes are separated by ';'
+    std::string rest;
+    std::getline(ss, rest);
+    std::stringstream opcodes(rest);
+    std::string opcode;
+    while (std::getline(opcodes, opcode, ';')) {
+      std::stringstream tokens(opcode);
+      std::string name, operand;
+      tokens >> name;
+      if (name == "id") {
+        std::getline(tokens >> std::ws, operand);
+        operand.erase(std::remove(operand.begin(), operand.end(), '"'),
+                      operand.end());
+        out.id = operand;
+      } else if (name == "bm" || name == "am") {
+        while (tokens >> operand) {
+          chess::Move move;
+          try {
+            move = chess::uci::parseSan(board, operand);
+          } catch (const std::exception &) {
+            return false;
+          }
+          if (move.move() == chess::Move::NO_MOVE)
+            return false;
+          (name == "bm" ? out.bestMoves : out.avoidMoves)
+              .push_back(chess::uci::moveToUci(move));
+        }
+      }
+    }
+    return !out.bestMoves.empty() || !out.avoidMoves.empty();
+  }
+};
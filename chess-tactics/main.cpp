@@ -0,0 +1,177 @@
+// Tactical test-suite runner (WAC, ECM, STS, ... in EPD with bm/am opcodes).
+// Runs an engine at a fixed time per position and records when the solution
+// first appeared and stayed as the engine's best move, using the engine's
+// live telemetry, then reports the solve rate as a function of time.
+//
+// chesstactics --suite wac.epd --engine negamax --movetime 5000 --threads 4
+
+#include "epd.h"
+#include "memory-budget.h"
+#include "players.h"
+#include "telemetry.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PositionResult {
+  bool solved = false;
+  int64_t solvedMS = -1;   // time the final solution first became stable
+  uint64_t solvedNodes = 0;
+  std::string played;
+};
+
+// engine's current best move from a telemetry sample
+std::string BestMove(const TelemetrySample &sample) {
+  if (sample.engine == TelemetrySample::Engine::MCTS)
+    return sample.numTopChildren > 0 ? sample.topMoves[0] : "";
+  std::string pv = sample.pv;
+  return pv.substr(0, pv.find(' '));
+}
+
+PositionResult RunPosition(const EpdPosition &position, const PlayerSpec &spec,
+                           int movetimeMS) {
+  auto player = spec.Create();
+  auto ring = std::make_unique<TelemetryRing>();
+  player->SetTelemetry(ring.get());
+
+  PositionResult result;
+  bool stable = false; // the solution has been best since solvedMS
+  auto observe = [&](const TelemetrySample &sample) {
+    bool solving = position.IsSolution(BestMove(sample));
+    if (solving && !stable) {
+      result.solvedMS = sample.timeMS;
+      result.solvedNodes = sample.nodes;
+    }
+    stable = solving;
+  };
+
+  // drain telemetry while the engine searches so the ring never overflows
+  auto search = std::async(std::launch::async, [&] {
+    return player->Move(position.fen, SearchLimits::MoveTime(movetimeMS));
+  });
+  TelemetrySample sample;
+  while (search.wait_for(std::chrono::milliseconds(5)) !=
+         std::future_status::ready)
+    while (ring->Pop(sample))
+      observe(sample);
+  result.played = search.get();
+  while (ring->Pop(sample))
+    observe(sample);
+
+  result.solved = position.IsSolution(result.played);
+  if (!result.solved) {
+    result.solvedMS = -1;
+    result.solvedNodes = 0;
+  } else if (result.solvedMS < 0) {
+    result.solvedMS = movetimeMS; // engine published nothing; count it at the end
+  }
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  std::string suitePath, engineSpec = "negamax";
+  int movetimeMS = 1000;
+  std::vector<int> threadCounts = {1};
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--suite" && hasValue)
+      suitePath = argv[++i];
+    else if (arg == "--engine" && hasValue)
+      engineSpec = argv[++i];
+    else if (arg == "--movetime" && hasValue)
+      movetimeMS = std::stoi(argv[++i]);
+    else if (arg == "--threads" && hasValue) {
+      // comma separated list, e.g. 1,2,4,8
+      threadCounts.clear();
+      std::stringstream ss(argv[++i]);
+      std::string count;
+      while (std::getline(ss, count, ','))
+        threadCounts.push_back(std::max(1, std::stoi(count)));
+    } else {
+      std::cerr << "usage: chesstactics --suite <file.epd> [--engine spec] "
+                   "[--movetime ms] [--threads 1,2,4]\n";
+      return 1;
+    }
+  }
+
+  PlayerSpec spec;
+  std::string error;
+  if (!PlayerSpec::Parse(engineSpec, spec, error)) {
+    std::cerr << "engine: " << error << std::endl;
+    return 1;
+  }
+
+  std::vector<EpdPosition> positions;
+  std::ifstream file(suitePath);
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    lineNumber++;
+    EpdPosition position;
+    if (EpdPosition::Parse(line, position))
+      positions.push_back(position);
+    else if (!line.empty())
+      std::cerr << "skipping line " << lineNumber << ": " << line << std::endl;
+  }
+  if (positions.empty()) {
+    std::cerr << "no positions read from '" << suitePath << "'" << std::endl;
+    return 1;
+  }
+
+  for (int threads : threadCounts) {
+    // positions are spread over `threads` concurrent searches
+    std::vector<PositionResult> results(positions.size());
+    std::atomic<size_t> next = 0;
+    std::mutex printMutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+      for (size_t i = next++; i < positions.size(); i = next++) {
+        results[i] = RunPosition(positions[i], spec, movetimeMS);
+        std::lock_guard<std::mutex> lock(printMutex);
+        std::printf("%-12s %-8s %-7s", positions[i].id.c_str(),
+                    results[i].played.c_str(),
+                    results[i].solved ? "solved" : "FAILED");
+        if (results[i].solved)
+          std::printf(" at %lldms, %llu nodes",
+                      (long long)results[i].solvedMS,
+                      (unsigned long long)results[i].solvedNodes);
+        std::printf("\n");
+      }
+    };
+    MemoryBudget::Global().SetConcurrency(threads);
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+      pool.emplace_back(worker);
+    for (auto &thread : pool)
+      thread.join();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    // solve rate as a function of time
+    std::printf("\n%s, %dms/position, %d thread(s): %.1fs wall\n",
+                engineSpec.c_str(), movetimeMS, threads, seconds);
+    std::printf("%10s %8s %8s\n", "time", "solved", "rate");
+    for (double fraction : {0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0}) {
+      int64_t limit = int64_t(movetimeMS * fraction);
+      int solved = 0;
+      for (auto &result : results)
+        solved += result.solved && result.solvedMS <= limit;
+      std::printf("%8lldms %8d %7.1f%%\n", (long long)limit, solved,
+                  100.0 * solved / positions.size());
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
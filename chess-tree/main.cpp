@@ -0,0 +1,278 @@
+// Summarizes a search-tree recording (chess-bot/tree-recorder.h) written by
+// chesscli --analyze --record, or by the engine when CHESS_TREE_FILE is set.
+//
+// chesstree <tree.bin> [--move n] [--top k]
+//
+// NegaMax: node types, where in the move list fail-high nodes cut off (by
+// remaining depth), and the nodes spent on moves searched before the cutoff
+// move, the cost of bad ordering, with the worst offenders.
+// MCTS: tree size and shape and how the root visits were spread.
+
+#include "chess.hpp"
+#include "tree-recorder.h"
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+using SearchRecord = TreeRecorder::SearchRecord;
+using MCTSRecord = TreeRecorder::MCTSRecord;
+
+// cutoff move index buckets: 1, 2, 3, 4, 5-8, 9-16, 17+
+const int BUCKETS = 7;
+const char *BUCKET_NAMES[BUCKETS] = {"1", "2", "3", "4", "5-8", "9-16", "17+"};
+
+int Bucket(int index) {
+  if (index < 4)
+    return index;
+  if (index < 8)
+    return 4;
+  return index < 16 ? 5 : 6;
+}
+
+std::string MoveName(uint16_t move) {
+  if (move == chess::Move::NO_MOVE)
+    return "root";
+  return chess::uci::moveToUci(chess::Move(move));
+}
+
+struct Wasted {
+  SearchRecord node;
+  uint64_t wasted;
+};
+
+// One move's worth of records
+struct MoveRecords {
+  uint64_t rootHash = 0;
+  int number = 0;
+  std::vector<SearchRecord> search;
+  std::vector<MCTSRecord> mcts;
+};
+
+// ---------------------------------------- NegaMax ---------------------------------------- //
+
+void SummarizeNegaMax(const MoveRecords &move, int top) {
+  struct Child {
+    uint8_t index;
+    uint32_t nodes;
+  };
+  std::vector<std::vector<Child>> pending(257);
+
+  uint64_t byType[6] = {};
+  uint64_t pv = 0, cut = 0, all = 0;
+  uint64_t cutNodes = 0, wastedNodes = 0;
+  std::map<int, std::array<uint64_t, BUCKETS>> cutoffsByDepth;
+  std::vector<Wasted> worst;
+  int iterations = 0;
+
+  for (const SearchRecord &record : move.search) {
+    byType[std::min<int>(record.type, 5)]++;
+    int ply = record.ply;
+
+    // children of this node are the records at ply + 1 since its last sibling
+    std::vector<Child> children = std::move(pending[ply + 1]);
+    for (size_t deeper = ply + 1; deeper < pending.size(); deeper++)
+      pending[deeper].clear();
+
+    if (record.type == TreeRecorder::ROOT) {
+      iterations++;
+      continue;
+    }
+    pending[ply].push_back({record.childIndex, record.nodes});
+    if (record.type != TreeRecorder::NEGAMAX)
+      continue;
+
+    if (record.score >= record.beta &&
+        record.cutoffIndex != TreeRecorder::NO_INDEX) {
+      cut++;
+      cutoffsByDepth[record.depth][Bucket(record.cutoffIndex)]++;
+
+      // everything searched before the refutation was wasted
+      uint64_t wasted = 0;
+      for (const Child &child : children)
+        if (child.index < record.cutoffIndex)
+          wasted += child.nodes;
+      cutNodes += record.nodes;
+      wastedNodes += wasted;
+      if (wasted > 0)
+        worst.push_back({record, wasted});
+    } else if (record.score > record.alpha) {
+      pv++;
+    } else {
+      all++;
+    }
+  }
+
+  std::printf("negamax: %zu records, %d completed iterations\n",
+              move.search.size(), iterations);
+  std::printf("  interior %" PRIu64 ", horizon %" PRIu64 ", tt cutoffs %" PRIu64
+              "\n",
+              byType[TreeRecorder::NEGAMAX], byType[TreeRecorder::QUIESCENCE],
+              byType[TreeRecorder::TT_CUTOFF]);
+  std::printf("  pv (exact) %" PRIu64 ", cut (fail high) %" PRIu64
+              ", all (fail low) %" PRIu64 "\n",
+              pv, cut, all);
+
+  // Where fail-high nodes found their refutation //
+  std::printf("  cutoff at move: depth");
+  for (const char *name : BUCKET_NAMES)
+    std::printf(" %6s", name);
+  std::printf("   count\n");
+  std::array<uint64_t, BUCKETS> total = {};
+  for (const auto &[depth, buckets] : cutoffsByDepth) {
+    uint64_t count = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+      count += buckets[b];
+      total[b] += buckets[b];
+    }
+    std::printf("                  %5d", depth);
+    for (uint64_t value : buckets)
+      std::printf(" %5.1f%%", 100.0 * value / std::max<uint64_t>(1, count));
+    std::printf(" %7" PRIu64 "\n", count);
+  }
+  std::printf("                    all");
+  for (uint64_t value : total)
+    std::printf(" %5.1f%%", 100.0 * value / std::max<uint64_t>(1, cut));
+  std::printf(" %7" PRIu64 "\n", cut);
+
+  // Cost of the ordering //
+  std::printf("  wasted: %" PRIu64 " of %" PRIu64
+              " nodes under fail-high nodes (%.1f%%) went to moves "
+              "searched before the cutoff move\n",
+              wastedNodes, cutNodes,
+              100.0 * wastedNodes / std::max<uint64_t>(1, cutNodes));
+
+  std::sort(worst.begin(), worst.end(),
+            [](const Wasted &a, const Wasted &b) { return a.wasted > b.wasted; });
+  if (worst.size() > size_t(top))
+    worst.resize(top);
+  for (const Wasted &entry : worst)
+    std::printf("    %016" PRIx64 " after %-5s ply %2d depth %2d cutoff at "
+                "move %3d/%-3d wasted %8" PRIu64 " of %8u nodes\n",
+                entry.node.hash, MoveName(entry.node.move).c_str(),
+                entry.node.ply, entry.node.depth,
+                entry.node.cutoffIndex + 1, entry.node.moveCount, entry.wasted,
+                entry.node.nodes);
+}
+
+// ---------------------------------------- MCTS ---------------------------------------- //
+
+void SummarizeMCTS(const MoveRecords &move, int top) {
+  const std::vector<MCTSRecord> &nodes = move.mcts;
+  if (nodes.empty())
+    return;
+
+  uint64_t expanded = 0, childSlots = 0, visitedOnce = 0;
+  int maxPly = 0;
+  std::vector<size_t> rootChildren;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    maxPly = std::max<int>(maxPly, nodes[i].ply);
+    if (nodes[i].children > 0) {
+      expanded++;
+      childSlots += nodes[i].children;
+    }
+    if (nodes[i].visits == 1)
+      visitedOnce++;
+    if (i > 0 && nodes[i].parent == 0)
+      rootChildren.push_back(i);
+  }
+
+  const MCTSRecord &root = nodes[0];
+  std::printf("mcts: %zu visited nodes, %u root visits, max depth %d\n",
+              nodes.size(), root.visits, maxPly);
+  std::printf("  expanded %" PRIu64 " (%.1f children each), visited once %"
+              PRIu64 " (%.1f%%)\n",
+              expanded, double(childSlots) / std::max<uint64_t>(1, expanded),
+              visitedOnce, 100.0 * visitedOnce / nodes.size());
+
+  // How the root's visits were spread //
+  std::sort(rootChildren.begin(), rootChildren.end(), [&](size_t a, size_t b) {
+    return nodes[a].visits > nodes[b].visits;
+  });
+  uint64_t others = 0;
+  for (size_t i = 1; i < rootChildren.size(); i++)
+    others += nodes[rootChildren[i]].visits;
+  std::printf("  %zu of %u root moves visited, %.1f%% of the visits went to "
+              "moves other than the most visited\n",
+              rootChildren.size(), root.children,
+              100.0 * others / std::max<uint32_t>(1, root.visits));
+  for (size_t i = 0; i < rootChildren.size() && i < size_t(top); i++) {
+    const MCTSRecord &child = nodes[rootChildren[i]];
+    std::printf("    %-5s visits %8u (%5.1f%%) Q %.3f\n",
+                MoveName(child.move).c_str(),
+                child.visits, 100.0 * child.visits / std::max(1u, root.visits),
+                child.wins / std::max(1u, child.visits));
+  }
+}
+
+// ---------------------------------------- main ---------------------------------------- //
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: chesstree <tree.bin> [--move n] [--top k]\n";
+    return 1;
+  }
+  std::string path = argv[1];
+  int onlyMove = 0;
+  int top = 10;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--move")
+      onlyMove = std::stoi(argv[i + 1]);
+    else if (arg == "--top")
+      top = std::max(1, std::stoi(argv[i + 1]));
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  TreeRecorder::FileHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, TreeRecorder::MAGIC,
+                  sizeof(TreeRecorder::MAGIC)) != 0 ||
+      header.version != TreeRecorder::VERSION ||
+      header.recordSize != sizeof(SearchRecord)) {
+    std::cerr << path << " is not a tree recording" << std::endl;
+    return 1;
+  }
+
+  // Split the stream into moves, summarize each when the next one starts //
+  MoveRecords move;
+  auto flush = [&]() {
+    if (move.number == 0 || (onlyMove != 0 && move.number != onlyMove))
+      return;
+    std::printf("move %d, root %016" PRIx64 "\n", move.number, move.rootHash);
+    if (!move.search.empty())
+      SummarizeNegaMax(move, top);
+    if (!move.mcts.empty())
+      SummarizeMCTS(move, top);
+    std::printf("\n");
+  };
+
+  char raw[sizeof(SearchRecord)];
+  while (file.read(raw, sizeof(raw))) {
+    uint8_t type = uint8_t(raw[0]);
+    if (type == TreeRecorder::MOVE) {
+      flush();
+      SearchRecord record;
+      std::memcpy(&record, raw, sizeof(record));
+      move = MoveRecords();
+      move.rootHash = record.hash;
+      move.number = int(record.nodes);
+    } else if (type == TreeRecorder::MCTS_NODE) {
+      MCTSRecord record;
+      std::memcpy(&record, raw, sizeof(record));
+      move.mcts.push_back(record);
+    } else {
+      SearchRecord record;
+      std::memcpy(&record, raw, sizeof(record));
+      move.search.push_back(record);
+    }
+  }
+  flush();
+  return 0;
+}
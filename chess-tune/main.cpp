@@ -0,0 +1,475 @@
+// Texel tuner for the PST evaluation (chess-bot/evaluation.h).
+// Streams labeled positions into a compact feature format, fits the sigmoid
+// scale K to the current weights, then minimizes the mean squared error
+// between game results and sigmoid(eval) over the material values and
+// piece-square tables with multithreaded full-batch Adam, and writes
+// chess-bot/eval-weights.h for the engine to compile in.
+// https://www.chessprogramming.org/Texel%27s_Tuning_Method
+//
+// chesstune <positions> [--out chess-bot/eval-weights.h] [--epochs 400]
+//           [--rate 1.0] [--threads n] [--limit n]
+//
+// One position per line: a FEN (the first four fields are used) and the game
+// result anywhere after it as 1-0 / 0-1 / 1/2-1/2 or [1.0] / [0.0] / [0.5].
+// Positions with the side to move in check are skipped; quiet positions work best.
+
+#include "chess.hpp"
+#include "eval-weights.h"
+#include "evaluation.h"
+#include "memory-budget.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TuneConfig {
+  std::string positions;
+  std::string out = "chess-bot/eval-weights.h";
+  int epochs = 400;
+  double rate = 1.0; // Adam step size in centipawns
+  int threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t limit = 0; // 0 == every position in the file
+};
+
+// Parameters: material values of pawn..queen (the king's cancels out), then
+// PST_PAWN..PST_KING and PST_KING_END, 64 squares each, from white's view
+const int MATERIAL = 5;
+const int TABLES = 7;
+const int KING_END_TABLE = 6;
+const int NUM_PARAMS = MATERIAL + TABLES * 64;
+const uint16_t BLACK_PIECE = 0x8000; // feature flag: subtract instead of add
+const double LN10_OVER_400 = std::log(10.0) / 400.0;
+
+int TableIndex(int table, int square) { return MATERIAL + table * 64 + square; }
+
+// ---------------------------------------- dataset ---------------------------------------- //
+
+// Every position is linear in the parameters: eval = fixed + material . values
+// + the PST entries of its pieces. Stored as structure-of-arrays, about 80
+// bytes per position, so tens of millions of positions fit in memory.
+struct Dataset {
+  std::vector<float> result;      // 1 white won, 0.5 draw, 0 black won
+  std::vector<float> fixed;       // untuned part of the eval (pawn structure), white's view
+  std::vector<int8_t> material;   // MATERIAL per position: white minus black piece counts
+  std::vector<uint32_t> offsets;  // features of position i: [offsets[i], offsets[i + 1])
+  std::vector<uint16_t> features; // parameter index | BLACK_PIECE
+
+  Dataset() { offsets.push_back(0); }
+  size_t Size() const { return result.size(); }
+
+  void Append(const Dataset &other) {
+    uint32_t base = offsets.back();
+    result.insert(result.end(), other.result.begin(), other.result.end());
+    fixed.insert(fixed.end(), other.fixed.begin(), other.fixed.end());
+    material.insert(material.end(), other.material.begin(),
+                    other.material.end());
+    for (size_t i = 1; i < other.offsets.size(); i++)
+      offsets.push_back(base + other.offsets[i]);
+    features.insert(features.end(), other.features.begin(),
+                    other.features.end());
+  }
+};
+
+bool ParseResult(const std::string &line, float &result) {
+  if (line.find("1/2-1/2") != std::string::npos ||
+      line.find("[0.5]") != std::string::npos)
+    result = 0.5f;
+  else if (line.find("1-0") != std::string::npos ||
+           line.find("[1.0]") != std::string::npos)
+    result = 1.0f;
+  else if (line.find("0-1") != std::string::npos ||
+           line.find("[0.0]") != std::string::npos)
+    result = 0.0f;
+  else
+    return false;
+  return true;
+}
+
+// Features of one position, the way Eval::Evaluate() scores it
+bool AddPosition(const std::string &line, Eval &eval, Dataset &data) {
+  float result;
+  if (!ParseResult(line, result))
+    return false;
+  std::stringstream ss(line);
+  std::string fen, field;
+  for (int i = 0; i < 4 && ss >> field; i++)
+    fen += (i ? " " : "") + field;
+  chess::Board board(fen + " 0 1");
+  if (board.inCheck())
+    return false;
+
+  bool endgame = eval.IsEndgame(board);
+  int8_t material[MATERIAL] = {};
+  for (int square = 0; square < 64; square++) {
+    chess::Piece piece = board.at(square);
+    if (piece == chess::Piece::NONE)
+      continue;
+    int type = static_cast<int>(piece.type().internal());
+    bool white = piece.color() == chess::Color::WHITE;
+    int table = type == 5 && endgame ? KING_END_TABLE : type;
+    uint16_t feature = TableIndex(table, white ? square : square ^ 56);
+    data.features.push_back(white ? feature : feature | BLACK_PIECE);
+    if (type < MATERIAL)
+      material[type] += white ? 1 : -1;
+  }
+
+  data.result.push_back(result);
+  data.fixed.push_back(float(eval.PawnStructure(board)));
+  data.material.insert(data.material.end(), material, material + MATERIAL);
+  data.offsets.push_back(uint32_t(data.features.size()));
+  return true;
+}
+
+// Reads the file a block of lines at a time and converts each block on all threads
+Dataset Load(const TuneConfig &config) {
+  std::ifstream file(config.positions);
+  Dataset data;
+  std::vector<std::string> lines;
+  const size_t BLOCK = 1 << 16;
+  size_t skipped = 0;
+  bool done = false;
+  while (!done) {
+    lines.clear();
+    std::string line;
+    while (lines.size() < BLOCK && std::getline(file, line))
+      lines.push_back(line);
+    done = lines.size() < BLOCK;
+
+    std::vector<Dataset> parts(config.threads);
+    std::vector<size_t> partSkipped(config.threads);
+    std::vector<std::thread> workers;
+    size_t per = (lines.size() + config.threads - 1) / config.threads;
+    for (int t = 0; t < config.threads; t++) {
+      workers.emplace_back([&, t]() {
+        Eval eval;
+        size_t end = std::min(lines.size(), (t + 1) * per);
+        for (size_t i = t * per; i < end; i++)
+          if (!AddPosition(lines[i], eval, parts[t]))
+            partSkipped[t]++;
+      });
+    }
+    for (std::thread &worker : workers)
+      worker.join();
+    for (int t = 0; t < config.threads; t++) {
+      data.Append(parts[t]); // in file order, so runs are reproducible
+      skipped += partSkipped[t];
+    }
+
+    std::printf("\rloaded %zu positions (%zu skipped)", data.Size(), skipped);
+    std::fflush(stdout);
+    if (config.limit && data.Size() >= config.limit)
+      done = true;
+  }
+  std::printf("\n");
+
+  if (config.limit && data.Size() > config.limit) {
+    data.result.resize(config.limit);
+    data.fixed.resize(config.limit);
+    data.material.resize(config.limit * MATERIAL);
+    data.offsets.resize(config.limit + 1);
+    data.features.resize(data.offsets.back());
+  }
+  return data;
+}
+
+// ---------------------------------------- model ---------------------------------------- //
+
+std::vector<double> InitialWeights() {
+  using namespace EvalWeights;
+  std::vector<double> weights(NUM_PARAMS);
+  const int values[MATERIAL] = {VALUE_PAWN, VALUE_KNIGHT, VALUE_BISHOP,
+                                VALUE_ROOK, VALUE_QUEEN};
+  const int *tables[TABLES] = {PST_PAWN,  PST_KNIGHT, PST_BISHOP,  PST_ROOK,
+                               PST_QUEEN, PST_KING,   PST_KING_END};
+  for (int i = 0; i < MATERIAL; i++)
+    weights[i] = values[i];
+  for (int table = 0; table < TABLES; table++)
+    for (int square = 0; square < 64; square++)
+      weights[TableIndex(table, square)] = tables[table][square];
+  return weights;
+}
+
+// White's-view eval of positions [begin, end) into evals
+void Evaluate(const Dataset &data, const std::vector<float> &weights,
+              size_t begin, size_t end, float *evals) {
+  for (size_t i = begin; i < end; i++) {
+    float eval = data.fixed[i];
+    const int8_t *material = &data.material[i * MATERIAL];
+    for (int type = 0; type < MATERIAL; type++)
+      eval += material[type] * weights[type];
+    for (uint32_t f = data.offsets[i]; f < data.offsets[i + 1]; f++) {
+      uint16_t feature = data.features[f];
+      float weight = weights[feature & ~BLACK_PIECE];
+      eval += feature & BLACK_PIECE ? -weight : weight;
+    }
+    evals[i - begin] = eval;
+  }
+}
+
+// Runs job(thread, begin, end) over contiguous slices of [0, count) on every thread
+template <typename Job> void Parallel(size_t count, int threads, Job job) {
+  std::vector<std::thread> workers;
+  size_t per = (count + threads - 1) / threads;
+  for (int t = 0; t < threads; t++)
+    workers.emplace_back(job, t, std::min(count, t * per),
+                         std::min(count, (t + 1) * per));
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+struct Pass {
+  double error = 0.0;
+  std::vector<double> gradient;
+};
+
+// Mean squared error and, if wanted, its gradient. Each thread evaluates its
+// slice in blocks: sparse sums into a float array, the sigmoid and error
+// terms over it in a branch-free loop the compiler vectorizes, then the
+// gradient scattered back onto the features.
+Pass Run(const Dataset &data, const std::vector<float> &weights, double K,
+         int threads, bool gradient) {
+  std::vector<Pass> parts(threads);
+  Parallel(data.Size(), threads, [&](int t, size_t begin, size_t end) {
+    Pass &part = parts[t];
+    if (gradient)
+      part.gradient.assign(NUM_PARAMS, 0.0);
+    const size_t BLOCK = 1024;
+    std::vector<float> evals(BLOCK), slopes(BLOCK);
+    const float scale = float(K * LN10_OVER_400);
+    for (size_t start = begin; start < end; start += BLOCK) {
+      size_t count = std::min(BLOCK, end - start);
+      Evaluate(data, weights, start, start + count, evals.data());
+
+      const float *results = &data.result[start];
+      double error = 0.0;
+      for (size_t i = 0; i < count; i++) {
+        float sigmoid = 1.0f / (1.0f + std::exp(-scale * evals[i]));
+        float diff = results[i] - sigmoid;
+        error += diff * diff;
+        slopes[i] = diff * sigmoid * (1.0f - sigmoid);
+      }
+      part.error += error;
+      if (!gradient)
+        continue;
+
+      for (size_t i = 0; i < count; i++) {
+        size_t position = start + i;
+        const int8_t *material = &data.material[position * MATERIAL];
+        for (int type = 0; type < MATERIAL; type++)
+          part.gradient[type] += slopes[i] * material[type];
+        for (uint32_t f = data.offsets[position];
+             f < data.offsets[position + 1]; f++) {
+          uint16_t feature = data.features[f];
+          part.gradient[feature & ~BLACK_PIECE] +=
+              feature & BLACK_PIECE ? -slopes[i] : slopes[i];
+        }
+      }
+    }
+  });
+
+  Pass total;
+  total.gradient.assign(NUM_PARAMS, 0.0);
+  for (const Pass &part : parts) {
+    total.error += part.error;
+    for (int p = 0; gradient && p < NUM_PARAMS; p++)
+      total.gradient[p] += part.gradient[p];
+  }
+  double n = double(std::max<size_t>(1, data.Size()));
+  total.error /= n;
+  for (double &g : total.gradient)
+    g *= -2.0 * K * LN10_OVER_400 / n; // d(error)/d(weight)
+  return total;
+}
+
+std::vector<float> ToFloat(const std::vector<double> &weights) {
+  return std::vector<float>(weights.begin(), weights.end());
+}
+
+// Sigmoid scale that best fits the current weights (golden-section search)
+double FitK(const Dataset &data, const std::vector<double> &weights,
+            int threads) {
+  std::vector<float> current = ToFloat(weights);
+  auto error = [&](double K) {
+    return Run(data, current, K, threads, false).error;
+  };
+  const double PHI = (std::sqrt(5.0) - 1.0) / 2.0;
+  double low = 0.1, high = 3.0;
+  for (int i = 0; i < 40; i++) {
+    double a = high - PHI * (high - low), b = low + PHI * (high - low);
+    if (error(a) < error(b))
+      high = b;
+    else
+      low = a;
+  }
+  return (low + high) / 2.0;
+}
+
+// ---------------------------------------- output ---------------------------------------- //
+
+bool WriteHeader(const std::string &path, const std::vector<double> &weights,
+                 const std::string &source) {
+  std::string temporary = path + ".tmp";
+  FILE *file = std::fopen(temporary.c_str(), "w");
+  if (!file)
+    return false;
+
+  std::fprintf(file,
+               "// Generated by chesstune; rerun it instead of editing by "
+               "hand.\n// Source: %s\n//\n"
+               "// Material and piece-square tables in centipawns, from "
+               "white's point of view:\n"
+               "// index 0 == a1, rank 1 first. Black pieces read square ^ "
+               "56.\n\n#pragma once\n\nnamespace EvalWeights {\n",
+               source.c_str());
+  const char *VALUES[MATERIAL] = {"PAWN", "KNIGHT", "BISHOP", "ROOK", "QUEEN"};
+  for (int type = 0; type < MATERIAL; type++)
+    std::fprintf(file, "inline constexpr int VALUE_%s = %ld;\n", VALUES[type],
+                 std::lround(weights[type]));
+  std::fprintf(file, "inline constexpr int VALUE_KING = %d;\n",
+               EvalWeights::VALUE_KING);
+
+  const char *TABLE_NAMES[TABLES] = {"PAWN", "KNIGHT", "BISHOP", "ROOK",
+                                     "QUEEN", "KING", "KING_END"};
+  for (int table = 0; table < TABLES; table++) {
+    std::fprintf(file, "\ninline constexpr int PST_%s[64] = {\n",
+                 TABLE_NAMES[table]);
+    for (int rank = 0; rank < 8; rank++) {
+      std::fprintf(file, "   ");
+      for (int column = 0; column < 8; column++)
+        std::fprintf(file, " %4ld,",
+                     std::lround(weights[TableIndex(table, rank * 8 + column)]));
+      std::fprintf(file, "\n");
+    }
+    std::fprintf(file, "};\n");
+  }
+  std::fprintf(file, "} // namespace EvalWeights\n");
+  if (std::fclose(file) != 0)
+    return false;
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  return !error;
+}
+
+// ---------------------------------------- main ---------------------------------------- //
+
+void PrintUsage() {
+  std::cerr
+      << "usage: chesstune <positions> [options]\n"
+         "  --out <file>      generated header (default "
+         "chess-bot/eval-weights.h)\n"
+         "  --epochs <n>      full passes over the positions (default 400)\n"
+         "  --rate <cp>       Adam step size (default 1.0)\n"
+         "  --threads <n>     worker threads (default: all cores)\n"
+         "  --limit <n>       use only the first n positions\n"
+         "One position per line: FEN followed by 1-0 / 0-1 / 1/2-1/2 or "
+         "[1.0] / [0.0] / [0.5].\n";
+}
+
+bool ParseArgs(int argc, char *argv[], TuneConfig &config) {
+  if (argc < 2)
+    return false;
+  config.positions = argv[1];
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "missing value for " << arg << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+    if (arg == "--out")
+      config.out = value;
+    else if (arg == "--epochs")
+      config.epochs = std::max(1, std::stoi(value));
+    else if (arg == "--rate")
+      config.rate = std::stod(value);
+    else if (arg == "--threads")
+      config.threads = std::max(1, std::stoi(value));
+    else if (arg == "--limit")
+      config.limit = std::stoull(value);
+    else {
+      std::cerr << "unknown argument: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  TuneConfig config;
+  if (!ParseArgs(argc, argv, config)) {
+    PrintUsage();
+    return 1;
+  }
+  if (!std::ifstream(config.positions)) {
+    std::cerr << "Failed to open " << config.positions << std::endl;
+    return 1;
+  }
+  MemoryBudget::Global().SetConcurrency(config.threads); // one pawn table per loader thread
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed = [&]() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+  Dataset data = Load(config);
+  if (data.Size() == 0) {
+    std::cerr << "no labeled positions in " << config.positions << std::endl;
+    return 1;
+  }
+  std::printf("%zu positions, %.1f MB of features, loaded in %.1fs\n",
+              data.Size(),
+              (data.features.size() * 2 + data.Size() * (8 + MATERIAL + 4)) /
+                  1048576.0,
+              elapsed());
+
+  std::vector<double> weights = InitialWeights();
+  double K = FitK(data, weights, config.threads);
+  double initialError = Run(data, ToFloat(weights), K, config.threads, false).error;
+  std::printf("K = %.4f, error %.6f\n", K, initialError);
+
+  // Adam: every weight moves about `rate` cp per epoch while the gradient's sign holds //
+  const double BETA1 = 0.9, BETA2 = 0.999, EPSILON = 1e-12;
+  std::vector<double> m(NUM_PARAMS, 0.0), v(NUM_PARAMS, 0.0);
+  double error = initialError;
+  for (int epoch = 1; epoch <= config.epochs; epoch++) {
+    Pass pass = Run(data, ToFloat(weights), K, config.threads, true);
+    error = pass.error;
+    double correction1 = 1.0 - std::pow(BETA1, epoch);
+    double correction2 = 1.0 - std::pow(BETA2, epoch);
+    for (int p = 0; p < NUM_PARAMS; p++) {
+      double g = pass.gradient[p];
+      m[p] = BETA1 * m[p] + (1.0 - BETA1) * g;
+      v[p] = BETA2 * v[p] + (1.0 - BETA2) * g * g;
+      weights[p] -= config.rate * (m[p] / correction1) /
+                    (std::sqrt(v[p] / correction2) + EPSILON);
+    }
+    if (epoch % 10 == 0 || epoch == config.epochs) {
+      std::printf("\repoch %4d  error %.6f  %.1fs", epoch, error, elapsed());
+      std::fflush(stdout);
+    }
+  }
+  error = Run(data, ToFloat(weights), K, config.threads, false).error;
+  std::printf("\nerror %.6f -> %.6f\n", initialError, error);
+
+  char source[512];
+  std::snprintf(source, sizeof(source),
+                "chesstune on %s, %zu positions, %d epochs, K %.4f, error "
+                "%.6f -> %.6f",
+                std::filesystem::path(config.positions).filename().c_str(),
+                data.Size(), config.epochs, K, initialError, error);
+  if (!WriteHeader(config.out, weights, source)) {
+    std::cerr << "Failed to write " << config.out << std::endl;
+    return 1;
+  }
+  std::printf("wrote %s; rebuild the engine to use it\n", config.out.c_str());
+  return 0;
+}